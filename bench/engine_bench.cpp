@@ -0,0 +1,80 @@
+//
+// Created by Lenart on 18/10/2026.
+//
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include "../sim/Machine.h"
+
+// body_length times ADD #1, looped iterations times with TIX and an extended JLT, then halts
+static std::shared_ptr<Memory> make_loop(size_t body_length, uint32_t iterations) {
+    auto memory = std::make_shared<Memory>();
+    Address_t address = 0;
+    auto put = [&](std::initializer_list<uint32_t> bytes) {
+        for (auto byte : bytes) memory->set_byte(address++, static_cast<Byte_t>(byte));
+    };
+
+    for (size_t i = 0; i < body_length; i++) put({0x19, 0x00, 0x01});
+    put({0x2D, 0x10 | (iterations >> 16 & 0x0F), iterations >> 8 & 0xFF, iterations & 0xFF});
+    put({0x3B, 0x10, 0x00, 0x00});
+    put({0x3F, 0x2F, 0xFD});
+    return memory;
+}
+
+struct Workload {
+    const char* name;
+    size_t body_length;
+    uint32_t iterations;
+};
+
+// Best of repetitions, engines take turns so they see the same machine load
+int main(int argc, char** argv) {
+    int repetitions = argc > 1 ? std::stoi(argv[1]) : 7;
+
+    static constexpr Workload workloads[] {
+        // Runs once, every block stays cold
+        {"straight", 300000, 1},
+        // Below the hot threshold
+        {"cold loop", 200000, 10},
+        {"hot loop", 20, 100000},
+    };
+    static constexpr std::pair<const char*, ExecutionEngine> engines[] {
+        {"interpreter", ExecutionEngine::Interpreter},
+        {"threaded", ExecutionEngine::Threaded},
+        {"basic block", ExecutionEngine::BasicBlock},
+    };
+
+    for (bool recording : {false, true}) {
+        std::cout << (recording ? "With" : "Without") << " undo recording" << std::endl;
+
+        for (auto& workload : workloads) {
+            std::array<double, std::size(engines)> best {};
+            best.fill(std::numeric_limits<double>::max());
+            uint64_t instructions = 0;
+
+            for (int repetition = 0; repetition < repetitions; repetition++) {
+                for (size_t i = 0; i < std::size(engines); i++) {
+                    auto memory = make_loop(workload.body_length, workload.iterations);
+                    Machine machine {0, memory, engines[i].second};
+                    machine.set_change_recording(recording);
+                    if (!recording) machine.set_checkpoint_interval(0);
+
+                    auto start = std::chrono::steady_clock::now();
+                    machine.run_until(std::numeric_limits<uint64_t>::max(), 0);
+                    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+                    best[i] = std::min(best[i], seconds);
+                    instructions = machine.get_instruction_count();
+                }
+            }
+
+            std::cout << "  " << std::left << std::setw(10) << workload.name << std::right << std::setw(9) << instructions;
+            for (size_t i = 0; i < std::size(engines); i++) {
+                std::cout << "  " << engines[i].first << " " << std::fixed << std::setprecision(4) << best[i] << "s";
+            }
+            std::cout << std::endl;
+        }
+    }
+}
@@ -4,6 +4,7 @@
 
 #include "Mnemonics.h"
 #include <map>
+#include <array>
 
 using std::map;
 
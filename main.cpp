@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <chrono>
 #include <fstream>
 #include <iostream>
 #include <iomanip>
@@ -6,6 +8,9 @@
 #include "sim/ObjLoader.h"
 #include "sim/Machine.h"
 #include "sim/Disassembler.h"
+#include "sim/CppTranslator.h"
+#include "sim/BatchRunner.h"
+#include "sim/Trace.h"
 #include "asm/Parser.h"
 #include "asm/SicCST.h"
 
@@ -27,15 +32,38 @@ private:
     };
 
     void initialize_commands() {
-        m_commands.push_back({"run", ": Run a program until a breakpoint or is halted", [&] (auto) {
-            m_machine->run();
+        m_commands.push_back({"run", " [n = unlimited]: Run a program until a breakpoint, it is halted or n instructions ran", [&] (auto maybe_count) {
+            if (maybe_count.has_value() && *maybe_count <= 0) {
+                std::cout << "Invalid count [" << std::dec << *maybe_count << "]" << std::endl;
+                return;
+            }
+            auto limit = maybe_count.has_value()
+                    ? m_machine->get_instruction_count() + *maybe_count
+                    : std::numeric_limits<uint64_t>::max();
 
-            if (m_machine->in_halt_condition()) {
-                std::cout << "Program halted" << std::endl;
-            } else {
-                std::cout << "Breakpoint at [";
-                print_zero_hex(6, m_registers.getPc());
-                std::cout << "]" << std::endl;
+            // Undo history is only needed once we are back in the debugger
+            if (m_turbo) m_machine->set_change_recording(false);
+            auto reason = m_machine->run_until(limit, StopReason::Breakpoint | StopReason::Watchpoint);
+            m_machine->set_change_recording(true);
+
+            switch (reason) {
+                case StopReason::Halted:
+                    std::cout << "Program halted" << std::endl;
+                    break;
+                case StopReason::Breakpoint:
+                    std::cout << "Breakpoint at [";
+                    print_zero_hex(6, m_registers.getPc());
+                    std::cout << "]" << std::endl;
+                    break;
+                case StopReason::Watchpoint:
+                    print_watch_hit(*m_machine->get_watch_hit());
+                    break;
+                case StopReason::Budget:
+                    std::cout << "Ran " << std::dec << *maybe_count << " instructions" << std::endl;
+                    break;
+                // Polling loops wait on devices all the time, only embedders ask to stop on it
+                case StopReason::DeviceWait:
+                    break;
             }
             print_pc_disassembly();
         }});
@@ -44,10 +72,15 @@ private:
             for (size_t i = 0; i < step_count; i++) {
                 print_pc_disassembly();
                 m_machine->step();
+                if (m_machine->get_watch_hit().has_value()) {
+                    print_watch_hit(*m_machine->get_watch_hit());
+                    break;
+                }
                 if (m_machine->in_halt_condition()) {
                     break;
                 }
             }
+            m_machine->flush_devices();
         }});
         m_commands.push_back({"undo", " [n = 1]: Undo last n steps", [&] (auto maybe_step_count) {
             int step_count = maybe_step_count.value_or(1);
@@ -56,12 +89,60 @@ private:
                 print_pc_disassembly();
             }
         }});
+        m_commands.push_back({"rstep", " [n = 1]: Step back n instructions", [&] (auto maybe_step_count) {
+            int step_count = maybe_step_count.value_or(1);
+
+            if (step_count <= 0 || !m_machine->reverse_step(step_count)) {
+                std::cout << "Can't step back [" << step_count << "]" << std::endl;
+                return;
+            }
+            print_pc_disassembly();
+        }});
+        m_commands.push_back({"rcontinue", ": Run backwards until a breakpoint or the oldest checkpoint", [&] (auto) {
+            if (m_machine->reverse_continue()) {
+                std::cout << "Breakpoint at [";
+                print_zero_hex(6, m_registers.getPc());
+                std::cout << "]" << std::endl;
+            } else if (m_machine->get_instruction_count() == 0) {
+                std::cout << "Program start" << std::endl;
+            } else {
+                std::cout << "Oldest checkpoint" << std::endl;
+            }
+            print_pc_disassembly();
+        }});
+        m_commands.push_back({"lastchange", " (address): Run backwards to the instruction that last changed byte at address", [&] (auto maybe_address) {
+            int address = maybe_address.value_or(-1);
+
+            if (address < 0 || address >= Memory::mem_size) {
+                std::cout << "Invalid memory address [" << address << "]" << std::endl;
+                return;
+            }
+
+            if (!m_machine->reverse_to_last_change(address)) {
+                std::cout << "No change of "; print_zero_hex(6, address); std::cout << " in history" << std::endl;
+                return;
+            }
+            print_pc_disassembly();
+        }});
+        m_commands.push_back({"checkpoint", " [interval = show]: Set instructions between time travel checkpoints", [&] (auto maybe_interval) {
+            if (maybe_interval.has_value()) {
+                if (*maybe_interval < 0) {
+                    std::cout << "Invalid checkpoint interval [" << *maybe_interval << "]" << std::endl;
+                    return;
+                }
+                m_machine->set_checkpoint_interval(*maybe_interval);
+            }
+
+            std::cout << std::dec << "Checkpoint every " << m_machine->get_checkpoint_interval() << " instructions, ";
+            std::cout << m_machine->get_checkpoint_count() << " checkpoints, at instruction ";
+            std::cout << m_machine->get_instruction_count() << std::endl;
+        }});
         m_commands.push_back({"history", " [max steps back = all]: show step history", [&] (auto maybe_max_steps) {
             int steps_back = 0;
             int max_steps = maybe_max_steps.value_or(m_changes.size());
             bool reached_end = true;
 
-            for (auto change : std::ranges::reverse_view(m_changes)) {
+            m_changes.for_each_newest_first([&](const Machine::Change_t& change) {
                 std::visit([&](auto&& arg) {
                     if (-steps_back >= max_steps) {
                         reached_end = false;
@@ -77,10 +158,240 @@ private:
                         std::cout << std::endl;
                     }
                 }, change);
-            }
+            });
 
             if (reached_end) std::cout << "End of history" << std::endl;
         }}) ;
+        m_commands.push_back({"journal", " (records): Set undo history capacity, clears the history", [&] (auto maybe_capacity) {
+            int capacity = maybe_capacity.value_or(-1);
+
+            if (capacity <= 0) {
+                std::cout << "Invalid journal capacity [" << capacity << "]" << std::endl;
+                return;
+            }
+
+            m_machine->set_journal_capacity(capacity);
+            std::cout << "Journal capacity " << std::dec << m_changes.capacity() << " records" << std::endl;
+        }});
+        m_commands.push_back({"turbo", " [enabled = toggle]: Run without recording undo history", [&] (auto maybe_enabled) {
+            m_turbo = maybe_enabled.has_value() ? *maybe_enabled != 0 : !m_turbo;
+            std::cout << "Turbo run " << (m_turbo ? "enabled" : "disabled") << std::endl;
+        }});
+        m_commands.push_back({"console", " (0 = unbuffered, 1 = line, 2 = full): Set console output buffering", [&] (auto maybe_policy) {
+            int policy = maybe_policy.value_or(-1);
+
+            if (policy < 0 || policy > 2) {
+                std::cout << "Invalid console buffering [" << policy << "]" << std::endl;
+                return;
+            }
+
+            auto flush_policy = static_cast<FlushPolicy>(policy);
+            m_machine->flush_devices();
+            m_machine->set_device(1, std::make_unique<StdoutDevice>(flush_policy));
+            m_machine->set_device(2, std::make_unique<StderrDevice>(flush_policy));
+            std::cout << "Console buffering set" << std::endl;
+        }});
+        m_commands.push_back({"sync", ": Write out buffered device output", [&] (auto) {
+            m_machine->flush_devices();
+            std::cout << "Devices synced" << std::endl;
+        }});
+        m_commands.push_back({"profile", " [enabled = toggle]: Count executions and memory accesses, enabling starts over", [&] (auto maybe_enabled) {
+            m_machine->set_profiling(maybe_enabled.has_value() ? *maybe_enabled != 0 : !m_machine->is_profiling());
+            std::cout << "Profiling " << (m_machine->is_profiling() ? "enabled" : "disabled") << std::endl;
+        }});
+        m_commands.push_back({"hotspots", " [n = 20]: Show the n most executed instructions and accessed addresses", [&] (auto maybe_count) {
+            int count = maybe_count.value_or(20);
+            auto profile = m_machine->get_profile();
+
+            if (!profile) {
+                std::cout << "Profiling was never enabled - use 'profile'" << std::endl;
+                return;
+            }
+            if (count <= 0) {
+                std::cout << "Invalid count [" << count << "]" << std::endl;
+                return;
+            }
+
+            profile->report(std::cout, m_disassembler, count);
+        }});
+        m_commands.push_back({"calls", " [n = 20]: Show the n subroutines with the most instructions executed", [&] (auto maybe_count) {
+            int count = maybe_count.value_or(20);
+            auto profile = m_machine->get_profile();
+
+            if (!profile) {
+                std::cout << "Profiling was never enabled - use 'profile'" << std::endl;
+                return;
+            }
+            if (count <= 0) {
+                std::cout << "Invalid count [" << count << "]" << std::endl;
+                return;
+            }
+
+            profile->report_functions(std::cout, m_disassembler, count);
+        }});
+        m_commands.push_back({"flamegraph", ": Write collapsed call stacks for flamegraph.pl to profile.folded", [&] (auto) {
+            auto profile = m_machine->get_profile();
+
+            if (!profile) {
+                std::cout << "Profiling was never enabled - use 'profile'" << std::endl;
+                return;
+            }
+
+            auto stream = std::ofstream {flamegraph_file_name};
+            if (!stream.is_open()) {
+                std::cout << "Cant open " << flamegraph_file_name << std::endl;
+                return;
+            }
+
+            profile->write_collapsed_stacks(stream);
+            std::cout << "Call stacks written to " << flamegraph_file_name << std::endl;
+        }});
+        m_commands.push_back({"trace", " [enabled = toggle]: Record executed instructions to trace.bin", [&] (auto maybe_enabled) {
+            bool enabled = maybe_enabled.has_value() ? *maybe_enabled != 0 : !m_machine->is_tracing();
+
+            if (!enabled) {
+                m_machine->set_trace(nullptr);
+                std::cout << "Tracing disabled" << std::endl;
+                return;
+            }
+
+            auto trace = std::make_unique<TraceRecorder>(trace_file_name, m_registers);
+            if (!trace->is_open()) {
+                std::cout << "Cant open " << trace_file_name << std::endl;
+                return;
+            }
+
+            m_machine->set_trace(std::move(trace));
+            std::cout << "Tracing to " << trace_file_name << std::endl;
+        }});
+        m_commands.push_back({"devlog", ": Save device input and output so far to devices.log", [&] (auto) {
+            auto stream = std::ofstream {device_log_file_name, std::ios::binary};
+            if (!stream.is_open()) {
+                std::cout << "Cant open " << device_log_file_name << std::endl;
+                return;
+            }
+
+            m_machine->save_device_log(stream);
+            std::cout << "Device log written to " << device_log_file_name << std::endl;
+        }});
+        m_commands.push_back({"replay", ": Feed device input from devices.log, only before the first step", [&] (auto) {
+            auto stream = std::ifstream {device_log_file_name, std::ios::binary};
+            if (!stream.is_open()) {
+                std::cout << "Cant open " << device_log_file_name << std::endl;
+                return;
+            }
+
+            if (!m_machine->replay_device_log(stream)) {
+                std::cout << "Can't replay " << device_log_file_name << " - it has to be a device log, loaded before the first step" << std::endl;
+                return;
+            }
+            std::cout << "Replaying " << device_log_file_name << std::endl;
+        }});
+        m_commands.push_back({"stats", " [reset = 0]: Show simulator counters, 1 resets them afterwards", [&] (auto maybe_reset) {
+            auto stats = m_machine->get_stats();
+            auto per_second = stats.run_seconds > 0 ? static_cast<double>(stats.run_instructions) / stats.run_seconds : 0;
+
+            std::cout << std::dec << "Instructions:   " << stats.instructions << " (format 1-4:";
+            for (auto count : stats.format_instructions) std::cout << " " << count;
+            std::cout << ")" << std::endl;
+            std::cout << "Memory:         " << stats.memory_reads << " reads, " << stats.memory_writes << " writes" << std::endl;
+            std::cout << "Devices:        " << stats.device_reads << " reads, " << stats.device_writes << " writes, ";
+            std::cout << stats.device_tests << " tests" << std::endl;
+            std::cout << "Journal:        " << stats.journal_bytes << " bytes" << std::endl;
+            std::cout << "Run:            " << stats.run_instructions << " instructions in " << stats.run_seconds << " s, ";
+            std::cout << static_cast<uint64_t>(per_second) << " per second" << std::endl;
+
+            if (maybe_reset.value_or(0) != 0) {
+                m_machine->reset_stats();
+                std::cout << "Counters reset" << std::endl;
+            }
+        }});
+        m_commands.push_back({"dumpstats", " [interval = stop]: Append counters to stats.jsonl every interval instructions", [&] (auto maybe_interval) {
+            int interval = maybe_interval.value_or(0);
+
+            if (interval <= 0) {
+                m_machine->set_stats_dump(nullptr, 0);
+                std::cout << "Stats dump stopped" << std::endl;
+                return;
+            }
+
+            auto stream = std::make_unique<std::ofstream>(stats_file_name, std::ios::app);
+            if (!stream->is_open()) {
+                std::cout << "Cant open " << stats_file_name << std::endl;
+                return;
+            }
+
+            m_machine->set_stats_dump(std::move(stream), interval);
+            std::cout << "Dumping stats to " << stats_file_name << " every " << std::dec << interval << " instructions" << std::endl;
+        }});
+        m_commands.push_back({"cycles", ": Show simulated cycles of the instructions executed so far", [&] (auto) {
+            auto instructions = m_machine->get_instruction_count();
+            auto cycles = m_machine->get_cycle_count();
+
+            std::cout << std::dec << cycles << " cycles in " << instructions << " instructions";
+            if (instructions != 0) {
+                std::cout << ", " << static_cast<double>(cycles) / static_cast<double>(instructions) << " per instruction";
+            }
+            std::cout << std::endl;
+        }});
+        m_commands.push_back({"costs", ": Load cycle costs from costs.txt, writes the current table there if it is missing", [&] (auto) {
+            auto stream = std::ifstream {cost_file_name};
+
+            if (!stream.is_open()) {
+                auto out_stream = std::ofstream {cost_file_name};
+                if (!out_stream.is_open()) {
+                    std::cout << "Cant open " << cost_file_name << std::endl;
+                    return;
+                }
+                m_machine->get_cost_model().write(out_stream);
+                std::cout << "Cost table written to " << cost_file_name << std::endl;
+                return;
+            }
+
+            auto cost_model = CostModel::load(stream);
+            if (!cost_model) {
+                std::cout << "Invalid cost table " << cost_file_name << std::endl;
+                return;
+            }
+
+            m_machine->set_cost_model(*cost_model);
+            std::cout << "Cycle costs loaded from " << cost_file_name << std::endl;
+        }});
+        m_commands.push_back({"cache", " [size = toggle]: Simulate instruction and data caches of size bytes each, 0 disables", [&] (auto maybe_size) {
+            if (maybe_size.value_or(1) == 0 || (!maybe_size && m_machine->is_caching())) {
+                m_machine->disable_caches();
+                std::cout << "Caches disabled" << std::endl;
+                return;
+            }
+
+            auto config = CacheConfig {};
+            int size = maybe_size.value_or(static_cast<int>(config.size));
+            config.size = static_cast<size_t>(size);
+            if (size < 0 || !config.is_valid()) {
+                std::cout << "Invalid cache size [" << std::dec << size << "]" << std::endl;
+                return;
+            }
+
+            m_machine->enable_caches(config, config);
+            std::cout << "Caches of " << std::dec << config.size << " bytes enabled" << std::endl;
+        }});
+        m_commands.push_back({"misses", " [n = 20]: Show cache hit rates and the n addresses that missed most", [&] (auto maybe_count) {
+            int count = maybe_count.value_or(20);
+
+            if (!m_machine->get_icache()) {
+                std::cout << "Caches were never enabled - use 'cache'" << std::endl;
+                return;
+            }
+            if (count <= 0) {
+                std::cout << "Invalid count [" << count << "]" << std::endl;
+                return;
+            }
+
+            std::cout << "Instruction cache: ";
+            m_machine->get_icache()->report(std::cout, count);
+            std::cout << "Data cache: ";
+            m_machine->get_dcache()->report(std::cout, count);
+        }});
         m_commands.push_back({"registers", ": Show current register state", [&] (auto) {
 
             auto show_register = [&](Register r) {
@@ -171,7 +482,35 @@ private:
             m_machine->clear_execution_breakpoints();
             std::cout << "Cleared breakpoints" << std::endl;
         }});
+        auto add_watch_command = [&](std::string_view name, std::string_view help_text, WatchKind kind) {
+            m_commands.push_back({name, help_text, [&, kind] (auto maybe_address) {
+                int address = maybe_address.value_or(-1);
+
+                if (address < 0 || address >= Memory::mem_size) {
+                    std::cout << "Invalid memory address [" << address << "]" << std::endl;
+                    return;
+                }
+
+                m_machine->set_watchpoint(address, 3, kind);
+                std::cout << "Set watchpoint at "; print_zero_hex(6, address); std::cout << std::endl;
+            }});
+        };
+        add_watch_command("watch", " (address): Stop after a write to word at address", WatchKind::Write);
+        add_watch_command("rwatch", " (address): Stop after a read of word at address", WatchKind::Read);
+        add_watch_command("cwatch", " (address): Stop after the value of word at address changes", WatchKind::Change);
+        m_commands.push_back({"nowatch", " [address = all]: Clear watchpoints at address", [&] (auto maybe_address) {
+            if (!maybe_address.has_value()) {
+                m_machine->clear_watchpoints();
+                std::cout << "Cleared watchpoints" << std::endl;
+                return;
+            }
+
+            m_machine->clear_watchpoint(*maybe_address);
+            std::cout << "Cleared watchpoints at "; print_zero_hex(6, *maybe_address); std::cout << std::endl;
+        }});
         m_commands.push_back({"exit", ": Exit the program", [&] (auto) {
+            // exit() skips destructors, devices, traces and stat dumps are written out here
+            m_machine.reset();
             exit(0);
         }});
         m_commands.push_back({"help", ": Show help (this)", [&](auto) {
@@ -228,6 +567,17 @@ private:
         std::cout << "["; print_zero_hex(6, target_address); std::cout << "]: ";
         std::cout << disassembly << std::endl;
     };
+    static void print_watch_hit(const WatchHit& hit) {
+        static constexpr std::array kind_names { "Read", "Write", "Change" };
+        auto width = hit.length == 1 ? 2 : 6;
+
+        std::cout << kind_names[static_cast<int>(hit.kind)] << " watchpoint at ["; print_zero_hex(6, hit.address); std::cout << "]: ";
+        print_zero_hex(width, hit.previous_value);
+        if (hit.kind != WatchKind::Read) {
+            std::cout << " -> "; print_zero_hex(width, hit.new_value);
+        }
+        std::cout << std::endl;
+    }
     void print_pc_disassembly() {
         print_disassembly(m_registers.getPc());
     }
@@ -277,18 +627,129 @@ private:
     Disassembler m_disassembler;
 
     const Registers& m_registers;
-    const std::deque<Machine::Change_t>& m_changes;
+    const ChangeJournal& m_changes;
     std::shared_ptr<Memory> m_memory;
     std::unique_ptr<Machine> m_machine;
     std::vector<Command> m_commands {};
+    bool m_turbo { false };
+
+    static constexpr const char* flamegraph_file_name = "profile.folded";
+    static constexpr const char* trace_file_name = "trace.bin";
+    static constexpr const char* device_log_file_name = "devices.log";
+    static constexpr const char* stats_file_name = "stats.jsonl";
+    static constexpr const char* cost_file_name = "costs.txt";
 };
 
+static std::string json_string(const std::string& value) {
+    std::string escaped {"\""};
+    for (char c : value) {
+        if (c == '"' || c == '\\') escaped += '\\';
+        if (static_cast<unsigned char>(c) < 0x20) {
+            std::stringstream ss {};
+            ss << "\\u" << std::setfill('0') << std::setw(4) << std::hex << static_cast<int>(c);
+            escaped += ss.str();
+            continue;
+        }
+        escaped += c;
+    }
+    return escaped + "\"";
+}
+
+// Runs to halt or until a budget runs out, 0 means no budget. The result is written as a single JSON object.
+static int run_headless(Machine& machine, const std::string& file_name, uint64_t max_instructions,
+                        double max_seconds, std::ostream& result_stream) {
+    // Nothing to undo or travel back to without the debugger
+    machine.set_change_recording(false);
+    machine.set_checkpoint_interval(0);
+    machine.set_device_logging(false);
+
+    // The clock is only read between slices
+    static constexpr uint64_t slice_length = 1 << 16;
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed = [&] { return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(); };
+
+    std::string_view exit_reason = "halted";
+    while (!machine.in_halt_condition()) {
+        if (max_instructions != 0 && machine.get_instruction_count() >= max_instructions) {
+            exit_reason = "instruction_limit";
+            break;
+        }
+        if (max_seconds > 0 && elapsed() >= max_seconds) {
+            exit_reason = "time_limit";
+            break;
+        }
+
+        auto slice_end = machine.get_instruction_count() + slice_length;
+        if (max_instructions != 0) slice_end = std::min(slice_end, max_instructions);
+        machine.run_until(slice_end, 0);
+    }
+    machine.flush_devices();
+
+    auto& registers = machine.get_registers();
+    result_stream << std::dec << "{\"file\": " << json_string(file_name);
+    result_stream << ", \"exit\": \"" << exit_reason << "\"";
+    result_stream << ", \"instructions\": " << machine.get_instruction_count();
+    result_stream << ", \"cycles\": " << machine.get_cycle_count();
+    result_stream << ", \"seconds\": " << std::fixed << std::setprecision(6) << elapsed();
+    if (machine.is_caching()) {
+        for (auto [name, cache] : {std::pair {"icache", machine.get_icache()}, std::pair {"dcache", machine.get_dcache()}}) {
+            auto& stats = cache->get_stats();
+            result_stream << ", \"" << name << "\": {\"hits\": " << stats.hits << ", \"misses\": " << stats.misses << "}";
+        }
+    }
+    result_stream << ", \"registers\": {";
+    static constexpr std::array<std::pair<const char*, Register>, 9> named_registers {{
+        {"A", Register::A}, {"X", Register::X}, {"L", Register::L}, {"B", Register::B}, {"S", Register::S},
+        {"T", Register::T}, {"F", Register::F}, {"PC", Register::PC}, {"SW", Register::SW}
+    }};
+    for (size_t i = 0; i < named_registers.size(); i++) {
+        auto [name, reg] = named_registers[i];
+        result_stream << (i ? ", " : "") << "\"" << name << "\": " << (registers.get(reg) & 0xffffff);
+    }
+    result_stream << "}}" << std::endl;
+
+    return machine.in_halt_condition() ? 0 : 1;
+}
+
 int sim_main(std::vector<std::string> args) {
-    std::string file_name {};
-    if (args.size() < 2) {
-        file_name = "../test_programs/addr.obj";
-    } else {
-        file_name = args[0];
+    std::string file_name = "../test_programs/addr.obj";
+    bool headless = false;
+    uint64_t max_instructions = 0;
+    double max_seconds = 0;
+    std::string result_file_name {};
+    std::string cost_file_name {};
+    std::optional<CacheConfig> icache_config {};
+    std::optional<CacheConfig> dcache_config {};
+
+    auto usage = [] {
+        std::cout << "[obj_filename] [--headless] [--instructions n] [--seconds s] [--result json_filename = stderr]";
+        std::cout << " [--costs cost_filename] [--icache size[,line_size[,ways]]] [--dcache size[,line_size[,ways]]]" << std::endl;
+        return 1;
+    };
+
+    try {
+        for (size_t i = 1; i < args.size(); i++) {
+            auto& arg = args[i];
+            bool has_value = i + 1 < args.size();
+
+            if (arg == "--headless") headless = true;
+            else if (arg == "--instructions" && has_value) max_instructions = std::stoull(args[++i]);
+            else if (arg == "--seconds" && has_value) max_seconds = std::stod(args[++i]);
+            else if (arg == "--result" && has_value) result_file_name = args[++i];
+            else if (arg == "--costs" && has_value) cost_file_name = args[++i];
+            else if (arg == "--icache" && has_value) {
+                icache_config = CacheConfig::parse(args[++i]);
+                if (!icache_config) return usage();
+            }
+            else if (arg == "--dcache" && has_value) {
+                dcache_config = CacheConfig::parse(args[++i]);
+                if (!dcache_config) return usage();
+            }
+            else if (arg.starts_with("--")) return usage();
+            else file_name = arg;
+        }
+    } catch (std::logic_error&) {
+        return usage();
     }
 
     auto stream = std::ifstream {file_name};
@@ -298,13 +759,181 @@ int sim_main(std::vector<std::string> args) {
         return 1;
     }
 
+    std::optional<CostModel> cost_model = CostModel {};
+    if (!cost_file_name.empty()) {
+        auto cost_stream = std::ifstream {cost_file_name};
+
+        if (!cost_stream.is_open()) {
+            std::cout << "Cant open " << cost_file_name << std::endl;
+            return 1;
+        }
+
+        cost_model = CostModel::load(cost_stream);
+        if (!cost_model) {
+            std::cout << "Invalid cost table " << cost_file_name << std::endl;
+            return 1;
+        }
+    }
+
     auto memory = std::make_shared<Memory>();
     auto loader = ObjLoader {memory, stream};
+
+    if (headless) {
+        auto machine = Machine {loader.load_obj(), memory, ExecutionEngine::Threaded};
+        machine.set_device(0, std::make_unique<StdinDevice>(false));
+        // Nobody watches the output as it is written, it goes out when a buffer fills up or the program halts
+        machine.set_device(1, std::make_unique<StdoutDevice>(FlushPolicy::Full));
+        machine.set_device(2, std::make_unique<StderrDevice>(FlushPolicy::Full));
+        machine.set_cost_model(*cost_model);
+        if (icache_config || dcache_config) machine.enable_caches(icache_config.value_or(CacheConfig {}), dcache_config.value_or(CacheConfig {}));
+        // Standard output belongs to the program
+        if (result_file_name.empty()) return run_headless(machine, file_name, max_instructions, max_seconds, std::cerr);
+
+        auto result_stream = std::ofstream {result_file_name};
+        if (!result_stream.is_open()) {
+            std::cout << "Cant open " << result_file_name << std::endl;
+            return 1;
+        }
+        return run_headless(machine, file_name, max_instructions, max_seconds, result_stream);
+    }
+
     auto machine = std::make_unique<Machine>(loader.load_obj(), memory);
+    machine->set_cost_model(*cost_model);
+    if (icache_config || dcache_config) machine->enable_caches(icache_config.value_or(CacheConfig {}), dcache_config.value_or(CacheConfig {}));
 
     MachineController{std::move(machine)}.run();
 }
 
+int translate_main(std::vector<std::string> args) {
+    if (args.size() != 3) {
+        std::cout << "(obj_filename) (cpp_filename)" << std::endl;
+        return 1;
+    }
+
+    auto stream = std::ifstream {args[1]};
+
+    if (!stream.is_open()) {
+        std::cout << "Cant open " << args[1] << std::endl;
+        return 1;
+    }
+
+    auto cpp_stream = std::ofstream {args[2]};
+
+    if (!cpp_stream.is_open()) {
+        std::cout << "Cant open " << args[2] << std::endl;
+        return 1;
+    }
+
+    auto memory = std::make_shared<Memory>();
+    auto loader = ObjLoader {memory, stream};
+    auto entry_address = loader.load_obj();
+
+    CppTranslator {memory}.translate(entry_address, cpp_stream);
+
+    return 0;
+}
+
+int trace_main(std::vector<std::string> args) {
+    if (args.size() < 2 || args.size() > 3) {
+        std::cout << "(trace_filename) [address = all]" << std::endl;
+        return 1;
+    }
+
+    auto stream = std::ifstream {args[1], std::ios::binary};
+
+    if (!stream.is_open()) {
+        std::cout << "Cant open " << args[1] << std::endl;
+        return 1;
+    }
+
+    auto reader = TraceReader {stream};
+
+    if (!reader.is_valid()) {
+        std::cout << "Not a trace " << args[1] << std::endl;
+        return 1;
+    }
+
+    // With an address only the instructions that changed it are shown
+    std::optional<Address_t> address {};
+    if (args.size() == 3) address = std::stoul(args[2], nullptr, 0);
+
+    auto disassembler = Disassembler {reader.get_memory()};
+    TraceRecord record {};
+    uint64_t count = 0;
+
+    while (reader.next(record)) {
+        count++;
+
+        if (address.has_value() && std::ranges::none_of(record.memory_changes, [&](const MemoryChange& change) {
+            return *address >= change.start_address && *address < change.start_address + change.changed_bytes_length;
+        })) continue;
+
+        std::cout << std::dec << std::setfill(' ') << std::setw(10) << record.index << " [0x" << std::setfill('0');
+        std::cout << std::setw(6) << std::hex << record.pc << "]: " << disassembler.dissasemble_at(record.pc) << std::endl;
+        for (auto& change : record.register_changes) std::cout << "    " << change << std::endl;
+        for (auto& change : record.memory_changes) std::cout << "    " << change << std::endl;
+    }
+
+    std::cout << std::dec << "Instructions: " << count << std::endl;
+
+    return 0;
+}
+
+int batch_main(std::vector<std::string> args) {
+    if (args.size() < 2) {
+        std::cout << "(obj_filename) [stdin_filename...]" << std::endl;
+        return 1;
+    }
+
+    auto stream = std::ifstream {args[1]};
+
+    if (!stream.is_open()) {
+        std::cout << "Cant open " << args[1] << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> input_filenames {args.begin() + 2, args.end()};
+    std::vector<BatchJob> jobs {};
+
+    for (auto& input_filename : input_filenames) {
+        auto input_stream = std::ifstream {input_filename, std::ios::binary};
+
+        if (!input_stream.is_open()) {
+            std::cout << "Cant open " << input_filename << std::endl;
+            return 1;
+        }
+
+        jobs.push_back({ .devices = {{0, std::string {std::istreambuf_iterator<char>(input_stream), {}}}} });
+    }
+
+    if (jobs.empty()) jobs.emplace_back();
+
+    auto runner = BatchRunner {stream};
+    runner.set_instruction_limit(100'000'000);
+    runner.set_lockstep_lanes(8);
+    auto results = runner.run(jobs);
+
+    size_t halted = 0;
+    uint64_t lockstep_instructions = 0;
+    for (size_t i = 0; i < results.size(); i++) {
+        auto& result = results[i];
+        halted += result.halted;
+        lockstep_instructions += result.lockstep_instruction_count;
+
+        std::cout << "[" << i << "] " << (input_filenames.empty() ? "-" : input_filenames[i]) << ": ";
+        std::cout << (result.halted ? "halted" : "stopped") << " after " << result.instruction_count;
+        std::cout << " instructions, A = " << (result.registers.getA() & 0xffffff) << std::endl;
+        std::cout << result.devices[1];
+        std::cerr << result.devices[2];
+    }
+
+    std::cout << "Instances: " << results.size() << ", halted: " << halted;
+    std::cout << ", instructions: " << runner.get_total_instruction_count();
+    std::cout << " (" << lockstep_instructions << " in lockstep)" << std::endl;
+
+    return halted == results.size() ? 0 : 1;
+}
+
 int asm_main(std::vector<std::string> args) {
     std::string file_name {};
     std::string output_filename {};
@@ -390,4 +1019,7 @@ int main(int argc, char* argv[]) {
 
     return asm_main(std::move(args));
 //    return sim_main(std::move(args));
+//    return translate_main(std::move(args));
+//    return trace_main(std::move(args));
+//    return batch_main(std::move(args));
 }
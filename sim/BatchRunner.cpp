@@ -0,0 +1,112 @@
+//
+// Created by Lenart on 17/10/2026.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include "BatchRunner.h"
+#include "LockstepGroup.h"
+#include "ObjLoader.h"
+
+BatchRunner::BatchRunner(std::ifstream& obj_stream, ExecutionEngine engine)
+    : m_image(std::make_shared<Memory>())
+    , m_start_address(ObjLoader {m_image, obj_stream}.load_obj())
+    , m_engine(engine)
+{}
+
+void BatchRunner::set_instruction_limit(uint64_t limit) {
+    m_instruction_limit = limit;
+}
+
+void BatchRunner::set_thread_count(size_t thread_count) {
+    m_thread_count = thread_count;
+}
+
+void BatchRunner::set_lockstep_lanes(size_t lanes) {
+    m_lockstep_lanes = std::max<size_t>(lanes, 1);
+}
+
+std::vector<BatchResult> BatchRunner::run(const std::vector<BatchJob>& jobs) {
+    std::vector<BatchResult> results(jobs.size());
+    std::atomic<size_t> next_group {};
+    auto group_count = (jobs.size() + m_lockstep_lanes - 1) / m_lockstep_lanes;
+
+    auto thread_count = m_thread_count ? m_thread_count : std::max(1u, std::thread::hardware_concurrency());
+    thread_count = std::min(thread_count, group_count);
+
+    std::vector<std::thread> threads {};
+    for (size_t i = 0; i < thread_count; i++) {
+        threads.emplace_back([&] {
+            for (auto group = next_group++; group < group_count; group = next_group++) {
+                auto first_job = group * m_lockstep_lanes;
+                auto job_count = std::min(m_lockstep_lanes, jobs.size() - first_job);
+
+                if (job_count == 1) {
+                    results[first_job] = run_instance(jobs[first_job]);
+                    continue;
+                }
+
+                auto group_results = LockstepGroup {*m_image, m_start_address, m_instruction_limit}
+                        .run(std::span {jobs}.subspan(first_job, job_count));
+                std::move(group_results.begin(), group_results.end(), results.begin() + first_job);
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+
+    m_total_instruction_count = 0;
+    for (auto& result : results) m_total_instruction_count += result.instruction_count;
+
+    return results;
+}
+
+uint64_t BatchRunner::get_total_instruction_count() const {
+    return m_total_instruction_count;
+}
+
+BatchResult BatchRunner::run_instance(const BatchJob& job) const {
+    // Pages stay shared with the image until the instance writes to them
+    auto memory = std::make_shared<Memory>(*m_image);
+    Machine machine {m_start_address, memory, m_engine};
+    machine.set_change_recording(false);
+    machine.set_checkpoint_interval(0);
+
+    std::map<Byte_t, const MemoryDevice*> devices {};
+    auto add_device = [&](Byte_t id, const std::string& input) {
+        auto device = std::make_unique<MemoryDevice>(input);
+        devices[id] = device.get();
+        machine.set_device(id, std::move(device));
+    };
+
+    for (Byte_t id : {0, 1, 2}) add_device(id, {});
+    for (auto& [id, input] : job.devices) add_device(id, input);
+    use_memory_devices(machine, devices);
+
+    return run_machine(machine, devices, m_instruction_limit);
+}
+
+void BatchRunner::use_memory_devices(Machine& machine, std::map<Byte_t, const MemoryDevice*>& devices) {
+    machine.set_device_factory([&devices](Byte_t id, bool) {
+        auto device = std::make_unique<MemoryDevice>();
+        devices[id] = device.get();
+        return device;
+    });
+}
+
+BatchResult BatchRunner::run_machine(Machine& machine, const std::map<Byte_t, const MemoryDevice*>& devices,
+                                     uint64_t instruction_limit) {
+    // Batch runs never travel back, the log would only grow
+    machine.set_device_logging(false);
+    machine.run_until(instruction_limit != 0 ? instruction_limit : std::numeric_limits<uint64_t>::max(), 0);
+
+    BatchResult result {
+        .halted = machine.in_halt_condition(),
+        .instruction_count = machine.get_instruction_count(),
+        .registers = machine.get_registers()
+    };
+    for (auto& [id, device] : devices) {
+        result.devices[id] = device->get_output();
+    }
+    return result;
+}
@@ -0,0 +1,66 @@
+//
+// Created by Lenart on 17/10/2026.
+//
+
+#ifndef ASS2_BATCHRUNNER_H
+#define ASS2_BATCHRUNNER_H
+
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+#include "Machine.h"
+
+struct BatchJob {
+    // Input of in memory devices, every device an instance uses is in memory and unlisted ones start empty
+    std::map<Byte_t, std::string> devices {};
+};
+
+struct BatchResult {
+    bool halted {};
+    uint64_t instruction_count {};
+    Registers registers {};
+    // Part of instruction_count executed in lockstep with other instances
+    uint64_t lockstep_instruction_count {};
+    // Output written to each in memory device
+    std::map<Byte_t, std::string> devices {};
+};
+
+// Loads an object file once and runs independent instances of it on a thread pool.
+// Instances share the loaded image copy on write, so starting one does not copy memory.
+class BatchRunner {
+public:
+    explicit BatchRunner(std::ifstream& obj_stream, ExecutionEngine engine = ExecutionEngine::Threaded);
+
+    // Instances still running after limit instructions are stopped, 0 means no limit
+    void set_instruction_limit(uint64_t limit);
+    // 0 uses one thread per host core
+    void set_thread_count(size_t thread_count);
+    // Jobs are run in groups of lanes sharing instruction decoding and dispatch, 1 runs every job on its own
+    void set_lockstep_lanes(size_t lanes);
+
+    std::vector<BatchResult> run(const std::vector<BatchJob>& jobs);
+    // Sum over all instances of the last run
+    [[nodiscard]] uint64_t get_total_instruction_count() const;
+
+    // Makes machine create devices it is missing as empty in memory devices, so instances never share files
+    static void use_memory_devices(Machine& machine, std::map<Byte_t, const MemoryDevice*>& devices);
+    // Steps machine until it halts or its instruction count reaches limit, 0 means no limit
+    static BatchResult run_machine(Machine& machine, const std::map<Byte_t, const MemoryDevice*>& devices,
+                                   uint64_t instruction_limit);
+
+private:
+    [[nodiscard]] BatchResult run_instance(const BatchJob& job) const;
+
+private:
+    std::shared_ptr<Memory> m_image;
+    Address_t m_start_address;
+    ExecutionEngine m_engine;
+    uint64_t m_instruction_limit {};
+    size_t m_thread_count {};
+    size_t m_lockstep_lanes { 1 };
+    uint64_t m_total_instruction_count {};
+};
+
+
+#endif //ASS2_BATCHRUNNER_H
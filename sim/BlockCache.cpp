@@ -0,0 +1,40 @@
+//
+// Created by Lenart on 17/10/2026.
+//
+
+#include "BlockCache.h"
+
+BasicBlock *BlockCache::find(Address_t address) {
+    auto it = m_blocks.find(address);
+    if (it == m_blocks.end()) return nullptr;
+    return &it->second;
+}
+
+bool BlockCache::mark_executed(Address_t address) {
+    return ++m_executions[address] >= hot_threshold;
+}
+
+BasicBlock &BlockCache::insert(BasicBlock block) {
+    if (m_code_bytes.empty()) m_code_bytes.resize(Memory::mem_size);
+    for (auto address = block.start_address; address < block.end_address && address < Memory::mem_size; address++) {
+        m_code_bytes[address] = true;
+    }
+
+    m_executions.erase(block.start_address);
+    auto address = block.start_address;
+    return m_blocks.insert_or_assign(address, std::move(block)).first->second;
+}
+
+bool BlockCache::contains_code(Address_t address, size_t length) const {
+    if (m_code_bytes.empty()) return false;
+    for (size_t i = 0; i < length; i++) {
+        if (address + i < Memory::mem_size && m_code_bytes[address + i]) return true;
+    }
+    return false;
+}
+
+void BlockCache::clear() {
+    m_blocks.clear();
+    m_executions.clear();
+    m_code_bytes = {};
+}
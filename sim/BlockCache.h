@@ -0,0 +1,43 @@
+//
+// Created by Lenart on 17/10/2026.
+//
+
+#ifndef ASS2_BLOCKCACHE_H
+#define ASS2_BLOCKCACHE_H
+
+#include <array>
+#include <unordered_map>
+#include <vector>
+#include "InstructionCache.h"
+
+struct BasicBlock {
+    Address_t start_address {};
+    Address_t end_address {};
+    std::vector<DecodedInstruction> instructions {};
+
+    // Chained successors, looked up by the PC the block exits with
+    std::array<Address_t, 2> successor_addresses {};
+    std::array<BasicBlock*, 2> successors {};
+};
+
+class BlockCache {
+public:
+    // Returns the compiled block at address or nullptr if it is still cold
+    [[nodiscard]] BasicBlock* find(Address_t address);
+    // Counts an interpreted execution at a block start, returns true once the address is hot
+    bool mark_executed(Address_t address);
+    BasicBlock& insert(BasicBlock block);
+
+    [[nodiscard]] bool contains_code(Address_t address, size_t length) const;
+    void clear();
+
+    static constexpr uint32_t hot_threshold = 16;
+private:
+    std::unordered_map<Address_t, BasicBlock> m_blocks {};
+    std::unordered_map<Address_t, uint32_t> m_executions {};
+    // Allocated with the first block, machines that never compile one don't pay for it
+    std::vector<bool> m_code_bytes {};
+};
+
+
+#endif //ASS2_BLOCKCACHE_H
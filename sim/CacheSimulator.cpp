@@ -0,0 +1,117 @@
+//
+// Created by Lenart on 17/10/2026.
+//
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include "CacheSimulator.h"
+
+bool CacheConfig::is_valid() const {
+    return std::has_single_bit(size) && std::has_single_bit(line_size) && std::has_single_bit(associativity) &&
+           line_size * associativity <= size;
+}
+
+std::optional<CacheConfig> CacheConfig::parse(const std::string &text) {
+    CacheConfig config {};
+    std::array<size_t*, 3> fields { &config.size, &config.line_size, &config.associativity };
+
+    auto stream = std::stringstream {text};
+    std::string field;
+    for (size_t i = 0; std::getline(stream, field, ','); i++) {
+        if (i >= fields.size()) return std::nullopt;
+
+        try {
+            size_t end;
+            *fields[i] = std::stoul(field, &end);
+            if (end != field.size()) return std::nullopt;
+        } catch (std::logic_error&) {
+            return std::nullopt;
+        }
+    }
+
+    if (!config.is_valid()) return std::nullopt;
+    return config;
+}
+
+CacheSimulator::CacheSimulator(const CacheConfig &config)
+    : m_config(config)
+    , m_line_bits(std::countr_zero(config.line_size))
+    , m_set_mask(config.size / config.line_size / config.associativity - 1)
+    , m_lines(config.size / config.line_size, empty_line)
+    , m_last_used(config.size / config.line_size)
+{
+    assert(config.is_valid() && "Cache sizes have to be powers of two");
+}
+
+void CacheSimulator::access(Address_t address, size_t length) {
+    bool missed = false;
+
+    auto last_line = (address + length - 1) >> m_line_bits;
+    for (auto line = address >> m_line_bits; line <= last_line; line++) {
+        missed |= !access_line(line);
+    }
+
+    if (missed) m_misses[address]++;
+}
+
+bool CacheSimulator::access_line(Address_t line) {
+    auto first_way = (line & m_set_mask) * m_config.associativity;
+    auto last_way = first_way + m_config.associativity;
+    m_clock++;
+
+    auto victim = first_way;
+    for (auto way = first_way; way < last_way; way++) {
+        if (m_lines[way] == line) {
+            m_last_used[way] = m_clock;
+            m_stats.hits++;
+            return true;
+        }
+        if (m_last_used[way] < m_last_used[victim]) victim = way;
+    }
+
+    m_lines[victim] = line;
+    m_last_used[victim] = m_clock;
+    m_stats.misses++;
+    return false;
+}
+
+const CacheConfig &CacheSimulator::get_config() const {
+    return m_config;
+}
+
+const CacheStats &CacheSimulator::get_stats() const {
+    return m_stats;
+}
+
+uint64_t CacheSimulator::get_misses(Address_t address) const {
+    auto it = m_misses.find(address);
+    return it == m_misses.end() ? 0 : it->second;
+}
+
+void CacheSimulator::report(std::ostream &os, size_t limit) const {
+    auto accesses = m_stats.hits + m_stats.misses;
+    auto miss_rate = accesses ? 100.0 * static_cast<double>(m_stats.misses) / static_cast<double>(accesses) : 0.0;
+
+    os << std::setfill(' ') << std::dec << m_config.size << " bytes, " << m_config.line_size << " byte lines, ";
+    os << m_config.associativity << " way: " << m_stats.hits << " hits, " << m_stats.misses << " misses (";
+    // Formatted apart so the fixed precision does not stick to os
+    auto rate = std::ostringstream {};
+    rate << std::fixed << std::setprecision(2) << miss_rate;
+    os << rate.str() << "%)" << std::endl;
+
+    std::vector<std::pair<Address_t, uint64_t>> misses {m_misses.begin(), m_misses.end()};
+    auto middle = misses.begin() + static_cast<std::ptrdiff_t>(std::min(limit, misses.size()));
+    std::partial_sort(misses.begin(), middle, misses.end(), [](auto& a, auto& b) {
+        return a.second != b.second ? a.second > b.second : a.first < b.first;
+    });
+
+    for (auto it = misses.begin(); it != middle; it++) {
+        os << std::setw(12) << it->second << " [0x" << std::setfill('0') << std::setw(6) << std::hex << it->first;
+        os << "]" << std::setfill(' ') << std::dec << std::endl;
+    }
+}
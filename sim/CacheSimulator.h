@@ -0,0 +1,65 @@
+//
+// Created by Lenart on 17/10/2026.
+//
+
+#ifndef ASS2_CACHESIMULATOR_H
+#define ASS2_CACHESIMULATOR_H
+
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Memory.h"
+
+struct CacheConfig {
+    size_t size { 4096 };
+    size_t line_size { 16 };
+    size_t associativity { 2 };
+
+    // Sizes have to be powers of two, with at least one set
+    [[nodiscard]] bool is_valid() const;
+    // Parses "size,line_size,associativity", missing fields keep their defaults
+    [[nodiscard]] static std::optional<CacheConfig> parse(const std::string& text);
+};
+
+struct CacheStats {
+    // Counted per line, an access that spans two lines counts twice
+    uint64_t hits {};
+    uint64_t misses {};
+};
+
+// Set associative cache with LRU replacement. Only tags are kept, the data stays in Memory.
+class CacheSimulator {
+public:
+    explicit CacheSimulator(const CacheConfig& config);
+
+    void access(Address_t address, size_t length);
+
+    [[nodiscard]] const CacheConfig& get_config() const;
+    [[nodiscard]] const CacheStats& get_stats() const;
+    // Accesses starting at address that missed at least one line
+    [[nodiscard]] uint64_t get_misses(Address_t address) const;
+
+    void report(std::ostream& os, size_t limit) const;
+
+private:
+    [[nodiscard]] bool access_line(Address_t line);
+
+    CacheConfig m_config;
+    size_t m_line_bits {};
+    size_t m_set_mask {};
+
+    static constexpr Address_t empty_line = ~Address_t {};
+    // associativity consecutive ways per set
+    std::vector<Address_t> m_lines {};
+    std::vector<uint64_t> m_last_used {};
+    uint64_t m_clock {};
+
+    CacheStats m_stats {};
+    std::unordered_map<Address_t, uint64_t> m_misses {};
+};
+
+
+#endif //ASS2_CACHESIMULATOR_H
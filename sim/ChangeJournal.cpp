@@ -0,0 +1,152 @@
+//
+// Created by Lenart on 17/10/2026.
+//
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include "ChangeJournal.h"
+
+static constexpr uint64_t value_mask = 0xffffff;
+
+static int32_t sign_extend(uint64_t value) {
+    auto v = static_cast<int32_t>(value & value_mask);
+    if (v & 0x800000) v |= static_cast<int32_t>(0xff000000);
+    return v;
+}
+
+ChangeJournal::ChangeJournal(size_t capacity)
+    : m_capacity(std::bit_ceil(std::max(capacity, min_capacity)))
+{}
+
+void ChangeJournal::push(const ChangeStart &change) {
+    push_record(static_cast<uint64_t>(Kind::Start) << 62 | static_cast<uint64_t>(change.cycles) << 24 | (change.pc & value_mask));
+}
+
+void ChangeJournal::push(const RegisterChange &change) {
+    auto register_id = static_cast<uint64_t>(change.register_id);
+
+    // Consecutive changes of the same register collapse into one
+    if (m_size > 0) {
+        auto& last = record(m_size - 1);
+        if (kind(last) == Kind::Register && ((last >> 48) & 0x3fff) == register_id) {
+            last = (last & ~value_mask) | (change.new_value & value_mask);
+            return;
+        }
+    }
+
+    push_record(encode(Kind::Register, register_id, change.previous_value, change.new_value));
+}
+
+void ChangeJournal::push(const MemoryChange &change) {
+    push_record(encode(Kind::Memory, change.changed_bytes_length, change.start_address, change.previous_value));
+    push_record(static_cast<uint64_t>(Kind::MemoryNewValue) << 62 | change.new_value);
+}
+
+Change_t ChangeJournal::back() const {
+    assert(m_size > 0);
+    auto index = m_size - 1;
+    if (kind(record(index)) == Kind::MemoryNewValue) index--;
+    return decode(index);
+}
+
+void ChangeJournal::pop_back() {
+    assert(m_size > 0);
+    if (kind(record(m_size - 1)) == Kind::MemoryNewValue) m_size--;
+    m_size--;
+}
+
+void ChangeJournal::clear() {
+    m_head = 0;
+    m_size = 0;
+}
+
+bool ChangeJournal::empty() const {
+    return m_size == 0;
+}
+
+size_t ChangeJournal::size() const {
+    return m_size;
+}
+
+size_t ChangeJournal::capacity() const {
+    return m_capacity;
+}
+
+uint64_t ChangeJournal::get_pushed_record_count() const {
+    return m_pushed_records;
+}
+
+void ChangeJournal::set_capacity(size_t capacity) {
+    m_capacity = std::bit_ceil(std::max(capacity, min_capacity));
+    m_records = {};
+    clear();
+}
+
+void ChangeJournal::push_record(uint64_t record) {
+    if (m_size == m_records.size()) make_room();
+
+    this->record(m_size) = record;
+    m_size++;
+    m_pushed_records++;
+}
+
+void ChangeJournal::make_room() {
+    if (m_records.empty()) m_records.resize(m_capacity);
+    else drop_oldest_step();
+}
+
+void ChangeJournal::drop_oldest_step() {
+    do {
+        m_head = (m_head + 1) & (m_records.size() - 1);
+        m_size--;
+    } while (m_size > 0 && kind(record(0)) != Kind::Start);
+}
+
+uint64_t& ChangeJournal::record(size_t index) {
+    return m_records[(m_head + index) & (m_records.size() - 1)];
+}
+
+uint64_t ChangeJournal::record(size_t index) const {
+    return m_records[(m_head + index) & (m_records.size() - 1)];
+}
+
+Change_t ChangeJournal::decode(size_t index) const {
+    auto r = record(index);
+
+    switch (kind(r)) {
+        case Kind::Start:
+            return ChangeStart {
+                .pc = static_cast<Address_t>(r & value_mask),
+                .cycles = static_cast<uint32_t>(r >> 24)
+            };
+        case Kind::Register:
+            return RegisterChange {
+                .register_id = static_cast<Register>((r >> 48) & 0x3fff),
+                .previous_value = sign_extend(r >> 24),
+                .new_value = sign_extend(r)
+            };
+        case Kind::Memory: {
+            auto length = static_cast<uint8_t>((r >> 48) & 0x3fff);
+            auto previous_value = length == 1 ? r & 0xff : static_cast<uint32_t>(sign_extend(r));
+            return MemoryChange {
+                .start_address = static_cast<Address_t>((r >> 24) & value_mask),
+                .changed_bytes_length = length,
+                .previous_value = static_cast<uint32_t>(previous_value),
+                .new_value = static_cast<uint32_t>(record(index + 1))
+            };
+        }
+        default:
+            assert(!"Orphaned memory change record");
+            return ChangeStart {};
+    }
+}
+
+uint64_t ChangeJournal::encode(Kind kind, uint64_t high, uint64_t previous_value, uint64_t new_value) {
+    return static_cast<uint64_t>(kind) << 62 | (high & 0x3fff) << 48 |
+           (previous_value & value_mask) << 24 | (new_value & value_mask);
+}
+
+ChangeJournal::Kind ChangeJournal::kind(uint64_t record) {
+    return static_cast<Kind>(record >> 62);
+}
@@ -0,0 +1,85 @@
+//
+// Created by Lenart on 17/10/2026.
+//
+
+#ifndef ASS2_CHANGEJOURNAL_H
+#define ASS2_CHANGEJOURNAL_H
+
+#include <cstdint>
+#include <variant>
+#include <vector>
+#include "Memory.h"
+#include "Registers.h"
+
+struct ChangeStart {
+    Address_t pc;
+    // Charged for the instruction, undo takes back exactly these
+    uint32_t cycles;
+};
+using Change_t = std::variant<ChangeStart, MemoryChange, RegisterChange>;
+
+// Fixed capacity ring buffer of packed 8 byte change records.
+// Capacity is rounded up to a power of two, once full whole steps are dropped from the oldest end.
+// The buffer is allocated by the first push, so a journal that never records costs nothing.
+class ChangeJournal {
+public:
+    explicit ChangeJournal(size_t capacity = default_capacity);
+
+    void push(const ChangeStart& change);
+    void push(const RegisterChange& change);
+    void push(const MemoryChange& change);
+    [[nodiscard]] Change_t back() const;
+    void pop_back();
+    void clear();
+
+    [[nodiscard]] bool empty() const;
+    // Number of packed records, a memory change takes two
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] size_t capacity() const;
+    // Records pushed since construction, including dropped and cleared ones
+    [[nodiscard]] uint64_t get_pushed_record_count() const;
+    // Drops the history
+    void set_capacity(size_t capacity);
+
+    // Calls fn with each change, newest first
+    template<class Fn>
+    void for_each_newest_first(Fn&& fn) const {
+        for (size_t i = m_size; i-- > 0;) {
+            if (kind(record(i)) == Kind::MemoryNewValue) continue;
+            fn(decode(i));
+        }
+    }
+
+    static constexpr size_t default_capacity = 1 << 16;
+    // Enough for the largest single step
+    static constexpr size_t min_capacity = 16;
+private:
+    enum class Kind : uint8_t {
+        Start,
+        Register,
+        // Followed by a MemoryNewValue record
+        Memory,
+        MemoryNewValue
+    };
+
+    void push_record(uint64_t record);
+    // Allocates the buffer on the first push, afterwards drops the oldest step
+    void make_room();
+    void drop_oldest_step();
+
+    [[nodiscard]] uint64_t& record(size_t index);
+    [[nodiscard]] uint64_t record(size_t index) const;
+    [[nodiscard]] Change_t decode(size_t index) const;
+
+    static uint64_t encode(Kind kind, uint64_t high, uint64_t previous_value, uint64_t new_value);
+    static Kind kind(uint64_t record);
+
+    size_t m_capacity;
+    std::vector<uint64_t> m_records {};
+    size_t m_head {};
+    size_t m_size {};
+    uint64_t m_pushed_records {};
+};
+
+
+#endif //ASS2_CHANGEJOURNAL_H
@@ -0,0 +1,117 @@
+//
+// Created by Lenart on 17/10/2026.
+//
+
+#include <sstream>
+#include <string>
+#include "CostModel.h"
+#include "InstructionCache.h"
+
+CostModel::CostModel()
+    : m_indirect(2)
+    , m_indexed(1)
+    , m_extended(1)
+    , m_device(10)
+{
+    using enum Opcode;
+
+    for (unsigned byte = 0; byte < 256; byte += 4) {
+        auto mnemonic = get_instruction_mnemonic(static_cast<Opcode>(byte));
+        if (!mnemonic) continue;
+
+        // One cycle per instruction byte fetched, one more for the memory operand
+        switch (mnemonic->format) {
+            case Format::F1: set_cycles(mnemonic->opcode, 1); break;
+            case Format::F3_4_mem: set_cycles(mnemonic->opcode, 4); break;
+            case Format::F3: set_cycles(mnemonic->opcode, 3); break;
+            default: set_cycles(mnemonic->opcode, 2);
+        }
+    }
+
+    set_cycles(MULR, 6);
+    set_cycles(DIVR, 12);
+    set_cycles(MUL, 8);
+    set_cycles(DIV, 14);
+    set_cycles(MULF, 10);
+    set_cycles(DIVF, 16);
+    // Jumps don't read their operand, JSUB also writes L
+    set_cycles(J, 3);
+    set_cycles(JEQ, 3);
+    set_cycles(JGT, 3);
+    set_cycles(JLT, 3);
+    set_cycles(JSUB, 4);
+}
+
+std::optional<CostModel> CostModel::load(std::istream &stream) {
+    CostModel model {};
+    std::string line;
+
+    while (std::getline(stream, line)) {
+        line = line.substr(0, line.find('#'));
+
+        auto line_stream = std::stringstream {line};
+        std::string name;
+        int64_t cycles;
+        if (!(line_stream >> name)) continue;
+        if (!(line_stream >> cycles) || cycles < 0 || cycles > UINT16_MAX) return std::nullopt;
+
+        std::string rest;
+        if (line_stream >> rest) return std::nullopt;
+
+        auto value = static_cast<uint32_t>(cycles);
+        if (name == "indirect") model.m_indirect = value;
+        else if (name == "immediate") model.m_immediate = value;
+        else if (name == "indexed") model.m_indexed = value;
+        else if (name == "extended") model.m_extended = value;
+        else if (name == "device") model.m_device = value;
+        else {
+            bool found = false;
+            for (unsigned byte = 0; byte < 256 && !found; byte += 4) {
+                auto mnemonic = get_instruction_mnemonic(static_cast<Opcode>(byte));
+                if (!mnemonic || mnemonic->mnemonic != name) continue;
+
+                model.set_cycles(mnemonic->opcode, value);
+                found = true;
+            }
+            if (!found) return std::nullopt;
+        }
+    }
+
+    return model;
+}
+
+void CostModel::write(std::ostream &stream) const {
+    for (unsigned byte = 0; byte < 256; byte += 4) {
+        auto mnemonic = get_instruction_mnemonic(static_cast<Opcode>(byte));
+        if (mnemonic) stream << mnemonic->mnemonic << " " << m_opcode_cycles[byte >> 2] << "\n";
+    }
+
+    stream << "# Added to the opcode cost\n";
+    stream << "indirect " << m_indirect << "\n";
+    stream << "immediate " << m_immediate << "\n";
+    stream << "indexed " << m_indexed << "\n";
+    stream << "extended " << m_extended << "\n";
+    stream << "device " << m_device << "\n";
+}
+
+uint32_t CostModel::get_cycles(const DecodedInstruction &instruction) const {
+    if (!instruction.valid) return 0;
+
+    auto opcode = instruction.opcode;
+    auto cycles = m_opcode_cycles[static_cast<uint8_t>(opcode) >> 2];
+
+    if (instruction.format == Format::F3 || instruction.format == Format::F3_4_mem) {
+        auto& flags = instruction.flags;
+        if (flags.is_indirect()) cycles += m_indirect;
+        if (flags.is_immediate()) cycles += m_immediate;
+        if (flags.is_indexed()) cycles += m_indexed;
+        if (instruction.length == 4) cycles += m_extended;
+    }
+
+    if (opcode == Opcode::RD || opcode == Opcode::WD || opcode == Opcode::TD) cycles += m_device;
+    return cycles;
+}
+
+void CostModel::set_cycles(Opcode opcode, uint32_t cycles) {
+    m_opcode_cycles[static_cast<uint8_t>(opcode) >> 2] = cycles;
+}
@@ -0,0 +1,44 @@
+//
+// Created by Lenart on 17/10/2026.
+//
+
+#ifndef ASS2_COSTMODEL_H
+#define ASS2_COSTMODEL_H
+
+#include <array>
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include "../common/Mnemonics.h"
+
+struct DecodedInstruction;
+
+// Simulated cycles of an instruction, a base cost per opcode plus surcharges for the addressing mode,
+// format 4 and device access
+class CostModel {
+public:
+    // Defaults roughly follow the memory accesses an instruction makes
+    CostModel();
+
+    // Reads a table of "name cycles" lines over the defaults. Names are mnemonics or one of the surcharges
+    // indirect, immediate, indexed, extended and device. Text after # is a comment.
+    // nullopt on an unknown name or a malformed line.
+    [[nodiscard]] static std::optional<CostModel> load(std::istream& stream);
+    // Writes the table in the format load() reads
+    void write(std::ostream& stream) const;
+
+    [[nodiscard]] uint32_t get_cycles(const DecodedInstruction& instruction) const;
+    void set_cycles(Opcode opcode, uint32_t cycles);
+
+private:
+    std::array<uint32_t, 64> m_opcode_cycles {};
+    uint32_t m_indirect {};
+    uint32_t m_immediate {};
+    uint32_t m_indexed {};
+    uint32_t m_extended {};
+    uint32_t m_device {};
+};
+
+
+#endif //ASS2_COSTMODEL_H
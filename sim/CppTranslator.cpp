@@ -0,0 +1,495 @@
+//
+// Created by Lenart on 17/10/2026.
+//
+
+#include <deque>
+#include <iomanip>
+#include <sstream>
+#include "CppTranslator.h"
+
+static constexpr size_t max_instructions = 1 << 16;
+
+static constexpr std::string_view prelude = R"(#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+
+namespace {
+
+constexpr uint32_t mem_size = 1 << 20;
+
+struct State {
+    int32_t A, X, L, B, S, T, F, SW;
+    uint32_t PC;
+} s {};
+
+uint8_t mem[mem_size];
+
+std::unique_ptr<std::fstream> files[256];
+
+int32_t sext(int32_t v) {
+    if (v & 0x800000) return v | static_cast<int32_t>(0xff000000);
+    return v & ~static_cast<int32_t>(0xff000000);
+}
+
+[[maybe_unused]] int32_t get_cc() {
+    return (s.SW & 0b1100) >> 2;
+}
+
+[[maybe_unused]] void set_cc(int32_t cc) {
+    cc = sext(cc);
+    if (cc < 0) cc = 0b01;
+    else if (cc > 0) cc = 0b10;
+    s.SW = sext((s.SW & ~0b1100) | (cc << 2));
+}
+
+[[maybe_unused]] void set_pc(int32_t pc) {
+    s.PC = static_cast<uint32_t>(sext(pc));
+}
+
+[[maybe_unused]] uint8_t get_byte(uint32_t addr) {
+    if (addr >= mem_size) return 0;
+    return mem[addr];
+}
+
+[[maybe_unused]] void set_byte(uint32_t addr, uint8_t b) {
+    if (addr >= mem_size) return;
+    mem[addr] = b;
+}
+
+[[maybe_unused]] uint32_t get_word(uint32_t addr) {
+    if (addr + 2 >= mem_size) return 0;
+    return static_cast<uint32_t>(sext(mem[addr] << 16 | mem[addr + 1] << 8 | mem[addr + 2]));
+}
+
+[[maybe_unused]] void set_word(uint32_t addr, uint32_t w) {
+    if (addr + 2 >= mem_size) return;
+    mem[addr] = (w & 0xff0000) >> 16;
+    mem[addr + 1] = (w & 0xff00) >> 8;
+    mem[addr + 2] = w & 0xff;
+}
+
+void open_file(uint8_t id, bool clear_file) {
+    std::stringstream filename {};
+    filename << "./" << std::setw(2) << std::setfill('0') << std::hex << (int)id << ".dev";
+    auto open_mode = std::ios::binary | std::ios::out | std::ios::in;
+    if (clear_file) open_mode |= std::ios::trunc;
+    files[id] = std::make_unique<std::fstream>(filename.str(), open_mode);
+}
+
+[[maybe_unused]] uint8_t device_read(uint8_t id) {
+    if (id == 0) {
+        if (!std::cin.rdbuf()->in_avail()) std::cout << ">" << std::flush;
+        return getc(stdin);
+    }
+    if (id <= 2) return 0;
+    if (!files[id]) open_file(id, false);
+    return files[id]->get();
+}
+
+[[maybe_unused]] void device_write(uint8_t id, uint8_t b) {
+    if (id == 1) std::cout << b << std::flush;
+    else if (id == 2) std::cerr << b << std::flush;
+    else if (id > 2) {
+        if (!files[id]) open_file(id, true);
+        files[id]->put(static_cast<char>(b));
+        files[id]->flush();
+    }
+    std::cout << std::flush;
+}
+
+[[maybe_unused]] bool device_test(uint8_t id) {
+    if (id <= 2) return true;
+    return files[id] && files[id]->good();
+}
+
+[[maybe_unused]] void not_implemented(const char* mnemonic) {
+    std::cout << "Machine: Instruction not implemented: " << mnemonic << std::endl;
+}
+
+[[maybe_unused, noreturn]] void trap(const char* reason) {
+    std::cerr << "Translated program: " << reason << " at PC 0x" << std::hex << s.PC << std::endl;
+    std::abort();
+}
+
+int halt() {
+    std::cout << std::flush;
+    std::cerr << std::hex << std::setfill('0')
+              << "A=0x" << std::setw(6) << (s.A & 0xffffff) << " X=0x" << std::setw(6) << (s.X & 0xffffff)
+              << " L=0x" << std::setw(6) << (s.L & 0xffffff) << " B=0x" << std::setw(6) << (s.B & 0xffffff)
+              << " S=0x" << std::setw(6) << (s.S & 0xffffff) << " T=0x" << std::setw(6) << (s.T & 0xffffff)
+              << " F=0x" << std::setw(6) << (s.F & 0xffffff) << " PC=0x" << std::setw(6) << (s.PC & 0xffffff)
+              << " SW=0x" << std::setw(6) << (s.SW & 0xffffff) << std::endl;
+    return 0;
+}
+
+)";
+
+CppTranslator::CppTranslator(std::shared_ptr<Memory> memory)
+    : m_memory(std::move(memory))
+{}
+
+void CppTranslator::translate(Address_t entry_address, std::ostream &os) {
+    m_instructions.clear();
+    discover(entry_address);
+
+    emit_prelude(os);
+    emit_image(os);
+
+    os << "} // namespace\n\n";
+    os << "int main() {\n";
+    os << "    load_image();\n";
+    os << "    s.PC = " << hex(entry_address) << ";\n\n";
+    os << "    for (;;) {\n";
+    os << "        switch (s.PC) {\n";
+
+    // Bodies are emitted first, so only addresses a goto jumps to get a label
+    m_labels.clear();
+    std::vector<std::string> bodies {};
+    for (auto& [address, instruction] : m_instructions) {
+        std::stringstream body {};
+        emit_instruction(body, address, instruction);
+        bodies.push_back(body.str());
+    }
+
+    auto body = bodies.begin();
+    for (auto& [address, instruction] : m_instructions) {
+        os << "            case " << hex(address) << ": ";
+        if (m_labels.contains(address)) os << label(address) << ": ";
+        os << "{\n" << *body++ << "            }\n";
+    }
+
+    os << "            default:\n";
+    os << "                trap(\"Jump to untranslated address\");\n";
+    os << "        }\n";
+    os << "    }\n";
+    os << "}\n";
+}
+
+void CppTranslator::discover(Address_t entry_address) {
+    std::deque<Address_t> pending { entry_address };
+
+    while (!pending.empty() && m_instructions.size() < max_instructions) {
+        auto address = pending.front();
+        pending.pop_front();
+
+        if (address >= Memory::mem_size || m_instructions.contains(address)) continue;
+
+        auto instruction = DecodedInstruction::decode(*m_memory, address);
+        m_instructions[address] = instruction;
+
+        if (!instruction.valid) continue;
+
+        auto next = address + instruction.length;
+        auto& flags = instruction.flags;
+        bool static_target = instruction.format == Format::F3_4_mem &&
+                !flags.is_indirect() && !flags.is_base_relative() && !flags.is_indexed();
+
+        using enum Opcode;
+        switch (instruction.opcode) {
+            case J:
+                if (static_target) pending.push_back(instruction.operand);
+                break;
+            case JEQ:
+            case JGT:
+            case JLT:
+            case JSUB:
+                if (static_target) pending.push_back(instruction.operand);
+                pending.push_back(next);
+                break;
+            case RSUB:
+                break;
+            case ADDR:
+            case SUBR:
+            case MULR:
+            case DIVR:
+            case RMO:
+                if (instruction.reg_2 != Register::PC) pending.push_back(next);
+                break;
+            case SHIFTL:
+            case SHIFTR:
+            case CLEAR:
+                if (instruction.reg_1 != Register::PC) pending.push_back(next);
+                break;
+            default:
+                pending.push_back(next);
+        }
+    }
+}
+
+void CppTranslator::emit_prelude(std::ostream &os) {
+    os << "// Translated from a SIC/XE object image, do not edit\n";
+    os << prelude;
+}
+
+void CppTranslator::emit_image(std::ostream &os) {
+    // Runs of non zero bytes, joined when separated by only a few zeroes
+    static constexpr size_t max_gap = 16;
+
+    std::vector<std::pair<Address_t, Address_t>> runs {};
+    for (Address_t address = 0; address < Memory::mem_size; address++) {
+        if (!m_memory->get_byte(address)) continue;
+
+        if (!runs.empty() && address - runs.back().second <= max_gap) {
+            runs.back().second = address + 1;
+        } else {
+            runs.emplace_back(address, address + 1);
+        }
+    }
+
+    for (auto& [start, end] : runs) {
+        os << "const uint8_t image_" << std::hex << std::setfill('0') << std::setw(6) << start << "[] = {";
+        for (auto address = start; address < end; address++) {
+            if ((address - start) % 16 == 0) os << "\n   ";
+            os << " " << hex(m_memory->get_byte(address)) << ",";
+        }
+        os << "\n};\n\n";
+    }
+
+    os << "void load_image() {\n";
+    for (auto& [start, end] : runs) {
+        os << "    std::memcpy(mem + " << hex(start) << ", image_" << std::hex << std::setfill('0') << std::setw(6)
+           << start << ", sizeof(image_" << std::setw(6) << start << "));\n";
+    }
+    os << "}\n\n";
+}
+
+void CppTranslator::emit_instruction(std::ostream &os, Address_t address, const DecodedInstruction &instruction) {
+    static constexpr std::string_view indent = "                ";
+    auto next = address + instruction.length;
+    bool falls_through = true;
+
+    auto mnemonic = get_instruction_mnemonic(instruction.opcode);
+    os << indent << "// " << (mnemonic ? mnemonic->mnemonic : "invalid") << "\n";
+
+    if (!instruction.valid) {
+        os << indent << "trap(\"Can't parse instruction\");\n";
+        return;
+    }
+
+    os << indent << "s.PC = " << hex(next) << ";\n";
+
+    auto reg_1 = instruction.reg_1;
+    auto reg_2 = instruction.reg_2;
+    auto valid_register = [](Register reg) { return static_cast<int>(reg) <= static_cast<int>(Register::CC); };
+
+    bool uses_reg_1 = instruction.format == Format::F2_reg || instruction.format == Format::F2_reg_num ||
+                      instruction.format == Format::F2_reg_reg;
+    bool uses_reg_2 = instruction.format == Format::F2_reg_reg;
+
+    if ((uses_reg_1 && !valid_register(reg_1)) || (uses_reg_2 && !valid_register(reg_2))) {
+        os << indent << "trap(\"Invalid register\");\n";
+        return;
+    }
+
+    auto r1 = get_register(reg_1);
+    auto r2 = get_register(reg_2);
+    auto word = [&] { return word_expression(instruction); };
+    auto byte = [&] { return byte_expression(instruction); };
+    auto store = [&] { return target_expression(instruction); };
+
+    std::stringstream body {};
+
+    using enum Opcode;
+    switch (instruction.opcode) {
+        // Format 2
+        case ADDR:
+            body << set_register(reg_2, r1 + " + " + r2);
+            falls_through = reg_2 != Register::PC;
+            break;
+        case SUBR:
+            body << set_register(reg_2, r1 + " - " + r2);
+            falls_through = reg_2 != Register::PC;
+            break;
+        case MULR:
+            body << set_register(reg_2, r1 + " * " + r2);
+            falls_through = reg_2 != Register::PC;
+            break;
+        case DIVR:
+            body << set_register(reg_2, r1 + " / " + r2);
+            falls_through = reg_2 != Register::PC;
+            break;
+        case COMPR:
+            body << set_register(Register::CC, r1 + " - " + r2);
+            break;
+        case SHIFTL:
+            body << "int32_t reg = " << r1 << "; ";
+            body << set_register(reg_1, "(reg << " + std::to_string(instruction.num_2 + 1) + " | ((reg & 0x800000) > 0))");
+            falls_through = reg_1 != Register::PC;
+            break;
+        case SHIFTR:
+            body << "int32_t reg = " << r1 << "; ";
+            body << set_register(reg_1, "(reg >> " + std::to_string(instruction.num_2 + 1) + " | ((reg & 1) << 23))");
+            falls_through = reg_1 != Register::PC;
+            break;
+        case RMO:
+            body << set_register(reg_2, r1);
+            falls_through = reg_2 != Register::PC;
+            break;
+        case CLEAR:
+            body << set_register(reg_1, "0");
+            falls_through = reg_1 != Register::PC;
+            break;
+        case TIXR:
+            body << set_register(Register::X, "s.X + 1") << " ";
+            body << set_register(Register::CC, "s.X - " + r1);
+            break;
+        // Format 3/4
+        case STA:  body << "set_word(" << store() << ", s.A);"; break;
+        case STX:  body << "set_word(" << store() << ", s.X);"; break;
+        case STL:  body << "set_word(" << store() << ", s.L);"; break;
+        case STCH: body << "set_byte(" << store() << ", s.A);"; break;
+        case STB:  body << "set_word(" << store() << ", s.B);"; break;
+        case STS:  body << "set_word(" << store() << ", s.S);"; break;
+        case STT:  body << "set_word(" << store() << ", s.T);"; break;
+        case STSW: body << "set_word(" << store() << ", s.SW);"; break;
+        case JEQ:
+            body << "if (get_cc() == 0b00) { " << jump(instruction, store()) << " }";
+            break;
+        case JGT:
+            body << "if (get_cc() == 0b10) { " << jump(instruction, store()) << " }";
+            break;
+        case JLT:
+            body << "if (get_cc() == 0b01) { " << jump(instruction, store()) << " }";
+            break;
+        case J:
+            body << "uint32_t target = " << store() << "; ";
+            body << "if (target == s.PC - 3u) { set_pc(int32_t(target)); return halt(); } ";
+            body << jump(instruction, "target");
+            falls_through = false;
+            break;
+        case RSUB:
+            body << "set_pc(s.L); continue;";
+            falls_through = false;
+            break;
+        case JSUB:
+            body << set_register(Register::L, "s.PC") << " ";
+            body << jump(instruction, store());
+            falls_through = false;
+            break;
+        case LDA:  body << set_register(Register::A, word()); break;
+        case LDX:  body << set_register(Register::X, word()); break;
+        case LDL:  body << set_register(Register::L, word()); break;
+        case LDB:  body << set_register(Register::B, word()); break;
+        case LDS:  body << set_register(Register::S, word()); break;
+        case LDT:  body << set_register(Register::T, word()); break;
+        case LDCH: body << set_register(Register::A, "(s.A & 0xffff00) | " + byte()); break;
+        case ADD:  body << set_register(Register::A, "s.A + " + word()); break;
+        case SUB:  body << set_register(Register::A, "s.A - " + word()); break;
+        case MUL:  body << set_register(Register::A, "s.A * " + word()); break;
+        case DIV:  body << set_register(Register::A, "s.A / " + word()); break;
+        case AND:  body << set_register(Register::A, "s.A & " + word()); break;
+        case OR:   body << set_register(Register::A, "s.A | " + word()); break;
+        case COMP: body << set_register(Register::CC, "s.A - " + word()); break;
+        case TIX:
+            body << set_register(Register::X, "s.X + 1") << " ";
+            body << set_register(Register::CC, "s.X - " + word());
+            break;
+        case RD:
+            body << set_register(Register::A, "(s.A & 0xffff00) | device_read(" + byte() + ")");
+            break;
+        case WD:
+            body << "device_write(" << byte() << ", s.A & 0xff);";
+            break;
+        case TD:
+            body << set_register(Register::CC, "device_test(" + byte() + ") ? 0 : -1");
+            break;
+        default:
+            body << "not_implemented(\"" << (mnemonic ? mnemonic->mnemonic : "") << "\");";
+    }
+
+    // Format 2 instructions writing PC jump through the dispatch switch
+    if (!falls_through && instruction.format != Format::F3 && instruction.format != Format::F3_4_mem) {
+        body << " continue;";
+    }
+
+    os << indent << body.str() << "\n";
+
+    if (!falls_through) return;
+
+    auto following = m_instructions.upper_bound(address);
+    if (following != m_instructions.end() && following->first == next) {
+        os << indent << "[[fallthrough]];\n";
+        return;
+    }
+
+    if (m_instructions.contains(next)) {
+        os << indent << goto_label(next) << "\n";
+    } else {
+        os << indent << "continue;\n";
+    }
+}
+
+std::string CppTranslator::operand_expression(const DecodedInstruction &instruction) const {
+    auto& flags = instruction.flags;
+    auto operand = "int32_t(" + std::to_string(instruction.operand) + ")";
+
+    if (flags.is_base_relative()) operand += " + s.B";
+    if (flags.is_indexed()) operand += " + s.X";
+
+    return "uint32_t(" + operand + ")";
+}
+
+std::string CppTranslator::word_expression(const DecodedInstruction &instruction) const {
+    if (instruction.flags.is_immediate()) return operand_expression(instruction);
+    return "get_word(" + target_expression(instruction) + ")";
+}
+
+std::string CppTranslator::byte_expression(const DecodedInstruction &instruction) const {
+    if (instruction.flags.is_immediate()) return "uint8_t(" + operand_expression(instruction) + ")";
+    return "get_byte(" + target_expression(instruction) + ")";
+}
+
+std::string CppTranslator::target_expression(const DecodedInstruction &instruction) const {
+    if (instruction.flags.is_indirect()) return "get_word(" + operand_expression(instruction) + ")";
+    return operand_expression(instruction);
+}
+
+std::string CppTranslator::jump(const DecodedInstruction &instruction, const std::string &target) {
+    auto& flags = instruction.flags;
+    bool static_target = !flags.is_indirect() && !flags.is_base_relative() && !flags.is_indexed();
+    auto target_address = static_cast<Address_t>(instruction.operand);
+
+    if (static_target && m_instructions.contains(target_address)) {
+        return "set_pc(" + target + "); " + goto_label(target_address);
+    }
+    return "set_pc(" + target + "); continue;";
+}
+
+std::string CppTranslator::goto_label(Address_t address) {
+    m_labels.insert(address);
+    return "goto " + label(address) + ";";
+}
+
+std::string CppTranslator::label(Address_t address) {
+    std::stringstream ss {};
+    ss << "L_" << std::hex << std::setfill('0') << std::setw(6) << address;
+    return ss.str();
+}
+
+std::string CppTranslator::hex(uint32_t value) {
+    std::stringstream ss {};
+    ss << "0x" << std::hex << std::setfill('0') << std::setw(2) << value;
+    return ss.str();
+}
+
+std::string CppTranslator::get_register(Register reg) {
+    switch (reg) {
+        case Register::PC: return "int32_t(s.PC)";
+        case Register::CC: return "get_cc()";
+        default: return "s." + std::string(register_to_str(reg));
+    }
+}
+
+std::string CppTranslator::set_register(Register reg, const std::string &value) {
+    switch (reg) {
+        case Register::PC: return "set_pc(" + value + ");";
+        case Register::CC: return "set_cc(" + value + ");";
+        default: return "s." + std::string(register_to_str(reg)) + " = sext(" + value + ");";
+    }
+}
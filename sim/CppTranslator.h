@@ -0,0 +1,53 @@
+//
+// Created by Lenart on 17/10/2026.
+//
+
+#ifndef ASS2_CPPTRANSLATOR_H
+#define ASS2_CPPTRANSLATOR_H
+
+#include <map>
+#include <set>
+#include <memory>
+#include <ostream>
+#include <string>
+#include "Memory.h"
+#include "InstructionCache.h"
+
+// Translates a loaded object image into a standalone C++ program.
+// Every instruction reachable from the entry point becomes straight line code,
+// jumps through registers or memory go through a switch over translated addresses.
+// Self modifying code is not supported, the image is translated as loaded.
+class CppTranslator {
+public:
+    explicit CppTranslator(std::shared_ptr<Memory> memory);
+
+    void translate(Address_t entry_address, std::ostream& os);
+
+private:
+    void discover(Address_t entry_address);
+
+    void emit_prelude(std::ostream& os);
+    void emit_image(std::ostream& os);
+    void emit_instruction(std::ostream& os, Address_t address, const DecodedInstruction& instruction);
+
+    [[nodiscard]] std::string operand_expression(const DecodedInstruction& instruction) const;
+    [[nodiscard]] std::string word_expression(const DecodedInstruction& instruction) const;
+    [[nodiscard]] std::string byte_expression(const DecodedInstruction& instruction) const;
+    [[nodiscard]] std::string target_expression(const DecodedInstruction& instruction) const;
+    [[nodiscard]] std::string jump(const DecodedInstruction& instruction, const std::string& target);
+    // Marks address as needing a label
+    [[nodiscard]] std::string goto_label(Address_t address);
+
+    [[nodiscard]] static std::string label(Address_t address);
+    [[nodiscard]] static std::string hex(uint32_t value);
+    [[nodiscard]] static std::string get_register(Register reg);
+    [[nodiscard]] static std::string set_register(Register reg, const std::string& value);
+
+private:
+    std::shared_ptr<Memory> m_memory;
+    std::map<Address_t, DecodedInstruction> m_instructions {};
+    std::set<Address_t> m_labels {};
+};
+
+
+#endif //ASS2_CPPTRANSLATOR_H
@@ -4,8 +4,13 @@
 
 #include <iostream>
 #include <iomanip>
+#include <iterator>
 #include "Device.h"
 
+StdoutDevice::StdoutDevice(FlushPolicy flush_policy)
+    : m_flush_policy(flush_policy)
+{}
+
 bool StdoutDevice::test() {
     return true;
 }
@@ -15,9 +20,24 @@ Byte_t StdoutDevice::read() {
 }
 
 void StdoutDevice::write(Byte_t b) {
-    std::cout << b << std::flush;
+    std::cout.put(static_cast<char>(b));
+    if (m_flush_policy == FlushPolicy::Unbuffered || (m_flush_policy == FlushPolicy::Line && b == '\n')) {
+        std::cout.flush();
+    }
+}
+
+std::unique_ptr<Device> StdoutDevice::clone() {
+    return std::make_unique<StdoutDevice>(m_flush_policy);
+}
+
+void StdoutDevice::flush() {
+    std::cout.flush();
 }
 
+StderrDevice::StderrDevice(FlushPolicy flush_policy)
+    : m_flush_policy(flush_policy)
+{}
+
 bool StderrDevice::test() {
     return true;
 }
@@ -27,17 +47,35 @@ Byte_t StderrDevice::read() {
 }
 
 void StderrDevice::write(Byte_t b) {
-    std::cerr << b << std::flush;
+    std::cerr.put(static_cast<char>(b));
+    if (m_flush_policy == FlushPolicy::Unbuffered || (m_flush_policy == FlushPolicy::Line && b == '\n')) {
+        std::cerr.flush();
+    }
+}
+
+std::unique_ptr<Device> StderrDevice::clone() {
+    return std::make_unique<StderrDevice>(m_flush_policy);
+}
+
+void StderrDevice::flush() {
+    std::cerr.flush();
 }
 
 bool StdinDevice::test() {
     return true;
 }
 
+StdinDevice::StdinDevice(bool prompt)
+    : m_prompt(prompt)
+{}
+
 Byte_t StdinDevice::read() {
-    if (!std::cin.rdbuf()->in_avail()) {
-        std::cout << ">" << std::flush;
+    // Buffered console output may be what the user is answering
+    std::cerr.flush();
+    if (m_prompt && !std::cin.rdbuf()->in_avail()) {
+        std::cout << ">";
     }
+    std::cout.flush();
     return getc(stdin);
 }
 
@@ -45,25 +83,102 @@ void StdinDevice::write(Byte_t b) {
 
 }
 
-FileDevice::FileDevice(Byte_t id, bool clear_file) {
+std::unique_ptr<Device> StdinDevice::clone() {
+    return std::make_unique<StdinDevice>(m_prompt);
+}
+
+MemoryDevice::MemoryDevice(std::string input)
+    : m_input(std::move(input))
+{}
+
+bool MemoryDevice::test() {
+    return !m_failed;
+}
+
+Byte_t MemoryDevice::read() {
+    if (m_read_position >= m_input.size()) {
+        m_failed = true;
+        return EOF;
+    }
+    return m_input[m_read_position++];
+}
+
+void MemoryDevice::write(Byte_t b) {
+    m_output.push_back(static_cast<char>(b));
+}
+
+std::unique_ptr<Device> MemoryDevice::clone() {
+    return std::make_unique<MemoryDevice>(*this);
+}
+
+const std::string &MemoryDevice::get_output() const {
+    return m_output;
+}
+
+FileDevice::FileDevice(Byte_t id, bool clear_file)
+    : m_id(id)
+    , m_buffer(std::make_unique<std::array<char, buffer_size>>())
+{
     std::stringstream filename {};
     filename << "./" << std::setw(2) << std::setfill('0') << std::hex << (int)id  << ".dev";
     auto open_mode = std::ios::binary | std::ios::out | std::ios::in;
     if (clear_file) open_mode |= std::ios::trunc;
-    m_file_stream = std::fstream {filename.str(), open_mode};
+    // The buffer has to be set before the file is opened
+    m_file_stream.rdbuf()->pubsetbuf(m_buffer->data(), buffer_size);
+    m_file_stream.open(filename.str(), open_mode);
 }
 
+FileDevice::~FileDevice() {
+    flush();
+}
 
 bool FileDevice::test() {
     return m_file_stream.good();
 }
 
 Byte_t FileDevice::read() {
-    return m_file_stream.get();
+    if (!m_file_stream.good()) return EOF;
+    switch_access(Access::Read);
+
+    auto c = m_file_stream.rdbuf()->sbumpc();
+    if (c == EOF) m_file_stream.setstate(std::ios::eofbit | std::ios::failbit);
+    return c;
 }
 
 void FileDevice::write(Byte_t b) {
-    m_file_stream.put(*reinterpret_cast<char*>(&b));
-    m_file_stream.flush();
+    if (!m_file_stream.good()) return;
+    switch_access(Access::Write);
+
+    if (m_file_stream.rdbuf()->sputc(static_cast<char>(b)) == EOF) {
+        m_file_stream.setstate(std::ios::badbit);
+    }
+}
+
+std::unique_ptr<Device> FileDevice::clone() {
+    // The copy reads the rest of the file and keeps its writes in memory, so the two never overwrite each other
+    flush();
+    if (!m_file_stream.good()) {
+        auto device = std::make_unique<MemoryDevice>();
+        // Reading the empty input fails the copy like the original
+        device->read();
+        return device;
+    }
+
+    auto position = m_file_stream.rdbuf()->pubseekoff(0, std::ios::cur);
+    std::string rest { std::istreambuf_iterator<char>(m_file_stream.rdbuf()), std::istreambuf_iterator<char>() };
+    m_file_stream.rdbuf()->pubseekpos(position);
+    m_last_access = Access::None;
+    return std::make_unique<MemoryDevice>(std::move(rest));
 }
 
+void FileDevice::flush() {
+    // Bypasses the stream state, so writes made before a failed read still reach the file
+    if (m_file_stream.is_open()) m_file_stream.rdbuf()->pubsync();
+}
+
+void FileDevice::switch_access(Access access) {
+    if (m_last_access != Access::None && m_last_access != access) {
+        m_file_stream.rdbuf()->pubseekoff(0, std::ios::cur);
+    }
+    m_last_access = access;
+}
@@ -5,8 +5,10 @@
 #ifndef ASS2_DEVICE_H
 #define ASS2_DEVICE_H
 
+#include <array>
 #include <fstream>
-
+#include <memory>
+#include <string>
 
 #include "../common/SicTypes.h"
 
@@ -16,39 +18,107 @@ public:
     virtual bool test() = 0;
     virtual Byte_t read() = 0;
     virtual void write(Byte_t b) = 0;
+    // Writes out anything the device buffers
+    virtual void flush() {}
+    // Independent copy that continues from the same position, used by Machine::fork
+    [[nodiscard]] virtual std::unique_ptr<Device> clone() = 0;
+};
+
+enum class FlushPolicy {
+    // Flush after every byte
+    Unbuffered,
+    // Flush after every newline, for interactive sessions
+    Line,
+    // Only flush when the stream buffer fills up or the device is flushed, for batch runs
+    Full
 };
 
 class StdinDevice : public Device {
 public:
+    // The prompt marks reads that wait for the user
+    explicit StdinDevice(bool prompt = true);
+
     bool test() override;
     Byte_t read() override;
     void write(Byte_t b) override;
+    [[nodiscard]] std::unique_ptr<Device> clone() override;
+
+private:
+    bool m_prompt;
 };
 
 class StdoutDevice : public Device {
 public:
+    explicit StdoutDevice(FlushPolicy flush_policy = FlushPolicy::Line);
+
     bool test() override;
     Byte_t read() override;
     void write(Byte_t b) override;
+    [[nodiscard]] std::unique_ptr<Device> clone() override;
+    void flush() override;
+
+private:
+    FlushPolicy m_flush_policy;
 };
 
 class StderrDevice : public Device {
 public:
+    explicit StderrDevice(FlushPolicy flush_policy = FlushPolicy::Line);
+
+    bool test() override;
+    Byte_t read() override;
+    void write(Byte_t b) override;
+    [[nodiscard]] std::unique_ptr<Device> clone() override;
+    void flush() override;
+
+private:
+    FlushPolicy m_flush_policy;
+};
+
+// Reads from an input buffer and collects writes, used for isolated runs
+class MemoryDevice : public Device {
+public:
+    explicit MemoryDevice(std::string input = {});
+
     bool test() override;
     Byte_t read() override;
     void write(Byte_t b) override;
+    [[nodiscard]] std::unique_ptr<Device> clone() override;
+
+    [[nodiscard]] const std::string& get_output() const;
+
+private:
+    std::string m_input;
+    size_t m_read_position {};
+    // Like a file stream, reading past the end makes the device fail its test
+    bool m_failed { false };
+    std::string m_output {};
 };
 
+// Reads ahead and collects writes in a large buffer, writes reach the file once the buffer fills up or on flush.
+// A clone is a MemoryDevice holding the rest of the file, its writes never reach the file.
 class FileDevice : public Device {
 public:
     explicit FileDevice(Byte_t id, bool clear_file);
+    ~FileDevice() override;
 
     bool test() override;
     Byte_t read() override;
     void write(Byte_t b) override;
+    [[nodiscard]] std::unique_ptr<Device> clone() override;
+    void flush() override;
 
+    static constexpr size_t buffer_size = 1 << 16;
 private:
+    enum class Access { None, Read, Write };
+
+    // Switching between reading and writing needs a seek in between
+    void switch_access(Access access);
+
+    Byte_t m_id;
+    std::unique_ptr<std::array<char, buffer_size>> m_buffer;
     std::fstream m_file_stream {};
+    Access m_last_access { Access::None };
 };
 
 
@@ -0,0 +1,59 @@
+//
+// Created by Lenart on 17/10/2026.
+//
+
+#include <array>
+#include "DeviceLog.h"
+
+static constexpr std::array<char, 8> magic { 'S', 'I', 'C', 'D', 'E', 'V', 'L', 'G' };
+static constexpr uint8_t version = 1;
+
+void device_log::write(std::ostream &stream, const std::vector<DeviceEvent> &events) {
+    stream.write(magic.data(), magic.size());
+    stream.put(static_cast<char>(version));
+
+    uint64_t previous_count = 0;
+    for (auto& event : events) {
+        for (auto delta = event.instruction_count - previous_count; ; delta >>= 7) {
+            stream.put(static_cast<char>(delta >= 0x80 ? (delta & 0x7f) | 0x80 : delta));
+            if (delta < 0x80) break;
+        }
+        stream.put(static_cast<char>(event.device_id));
+        stream.put(static_cast<char>(event.access));
+        stream.put(static_cast<char>(event.value));
+        previous_count = event.instruction_count;
+    }
+}
+
+std::optional<std::vector<DeviceEvent>> device_log::read(std::istream &stream) {
+    std::array<char, magic.size()> file_magic {};
+    stream.read(file_magic.data(), file_magic.size());
+    if (!stream || file_magic != magic || stream.get() != version) return std::nullopt;
+
+    std::vector<DeviceEvent> events {};
+    uint64_t count = 0;
+
+    while (stream.peek() != std::istream::traits_type::eof()) {
+        uint64_t delta = 0;
+        for (int shift = 0; ; shift += 7) {
+            auto byte = stream.get();
+            if (byte == std::istream::traits_type::eof() || shift >= 64) return std::nullopt;
+            delta |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) break;
+        }
+
+        std::array<char, 3> fields {};
+        stream.read(fields.data(), fields.size());
+        if (!stream || static_cast<uint8_t>(fields[1]) > static_cast<uint8_t>(DeviceAccess::Test)) return std::nullopt;
+
+        count += delta;
+        events.push_back({
+            .instruction_count = count,
+            .device_id = static_cast<Byte_t>(fields[0]),
+            .access = static_cast<DeviceAccess>(fields[1]),
+            .value = static_cast<Byte_t>(fields[2])
+        });
+    }
+
+    return events;
+}
@@ -0,0 +1,39 @@
+//
+// Created by Lenart on 17/10/2026.
+//
+
+#ifndef ASS2_DEVICELOG_H
+#define ASS2_DEVICELOG_H
+
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <vector>
+#include "../common/SicTypes.h"
+
+enum class DeviceAccess : uint8_t {
+    Read,
+    Write,
+    Test
+};
+
+struct DeviceEvent {
+    // Instruction count after the instruction that caused the event
+    uint64_t instruction_count;
+    Byte_t device_id;
+    DeviceAccess access;
+    // Byte read or written, 1 or 0 for a test
+    Byte_t value;
+};
+
+// Device log file, the magic and a version byte followed by one record per event:
+// varint instruction count delta from the previous event, device id, access and value
+namespace device_log {
+    void write(std::ostream& stream, const std::vector<DeviceEvent>& events);
+    // nullopt when the stream is not a device log of a supported version
+    [[nodiscard]] std::optional<std::vector<DeviceEvent>> read(std::istream& stream);
+}
+
+
+#endif //ASS2_DEVICELOG_H
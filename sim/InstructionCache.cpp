@@ -0,0 +1,149 @@
+//
+// Created by Lenart on 17/10/2026.
+//
+
+#include <algorithm>
+#include "InstructionCache.h"
+
+static Address_t sign_extend_address(Address_t address) {
+    if (address & 0x800000) return address | 0xff000000;
+    return address & ~0xff000000;
+}
+
+DecodedInstruction DecodedInstruction::decode(const Memory &memory, Address_t address) {
+    DecodedInstruction instruction {};
+
+    auto b0 = memory.get_byte(address);
+    auto b1 = memory.get_byte(address + 1);
+    auto b2 = memory.get_byte(address + 2);
+
+    instruction.opcode = static_cast<Opcode>(b0 & 0b11111100);
+
+    auto mnemonic = get_instruction_mnemonic(instruction.opcode);
+
+    if (mnemonic && mnemonic->format == Format::F1) {
+        instruction.format = Format::F1;
+        instruction.length = 1;
+        instruction.valid = true;
+        return instruction;
+    }
+
+    if (mnemonic && mnemonic->format >= Format::F2_num && mnemonic->format <= Format::F2_reg_reg) {
+        instruction.format = mnemonic->format;
+        instruction.length = 2;
+        instruction.reg_1 = static_cast<Register>((b1 & 0xF0) >> 4);
+        instruction.reg_2 = static_cast<Register>(b1 & 0x0F);
+        instruction.num_2 = b1 & 0x0F;
+        instruction.valid = true;
+        return instruction;
+    }
+
+    instruction.length = 3;
+    instruction.flags = Flags {b0, static_cast<uint8_t>(b1 >> 4)};
+
+    if (!instruction.flags.is_valid()) return instruction;
+
+    // Standard SIC
+    if (instruction.flags.is_sic()) {
+        instruction.operand = ((b1 & 0x7F) << 8) | b2;
+    }
+        // F4
+    else if (instruction.flags.is_extended()) {
+        uint8_t b3 = memory.get_byte(address + 3);
+        instruction.length = 4;
+        instruction.operand = (b1 & 0x0F) << 16 | b2 << 8 | b3;
+        // Extended addressing is always absolute
+        instruction.flags.set_base_relative(false);
+        instruction.flags.set_pc_relative(false);
+    }
+        // F3
+    else {
+        instruction.operand = (b1 & 0x0F) << 8 | b2;
+
+        if (instruction.flags.is_pc_relative()) {
+            auto pc = sign_extend_address(address + instruction.length);
+            instruction.operand = instruction.operand >= 2048 ? instruction.operand - 4096 : instruction.operand;
+            instruction.operand += static_cast<int32_t>(pc);
+        }
+    }
+
+    if (!mnemonic) return instruction;
+
+    instruction.format = mnemonic->format;
+    instruction.valid = true;
+    return instruction;
+}
+
+InstructionCache::InstructionCache(std::shared_ptr<Memory> memory)
+    : m_memory(std::move(memory))
+{}
+
+const DecodedInstruction &InstructionCache::get(Address_t address) {
+    if (address >= Memory::mem_size) {
+        m_uncached = DecodedInstruction::decode(*m_memory, address);
+        m_uncached.cycles = m_cost_model.get_cycles(m_uncached);
+        return m_uncached;
+    }
+
+    auto& page = m_pages[address / page_size];
+    if (!page) page = std::make_unique<Page>();
+
+    auto& instruction = (*page)[address % page_size];
+    if (!instruction.valid) {
+        instruction = DecodedInstruction::decode(*m_memory, address);
+        instruction.breakpoint = has_breakpoint(address);
+        instruction.cycles = m_cost_model.get_cycles(instruction);
+    }
+    return instruction;
+}
+
+void InstructionCache::invalidate(Address_t address, size_t length) {
+    // Instructions are up to 4 bytes long, so an entry starting 3 bytes before the write may overlap it
+    auto start = address >= 3 ? address - 3 : 0;
+    auto end = std::min<size_t>(address + length, Memory::mem_size);
+
+    for (auto a = start; a < end; a++) {
+        auto& page = m_pages[a / page_size];
+        if (page) (*page)[a % page_size].valid = false;
+    }
+}
+
+void InstructionCache::clear() {
+    for (auto& page : m_pages) page.reset();
+}
+
+void InstructionCache::set_breakpoint(Address_t address, bool enabled) {
+    if (address >= Memory::mem_size) return;
+    if (!enabled && m_breakpoints.empty()) return;
+
+    if (m_breakpoints.empty()) m_breakpoints.resize(Memory::mem_size);
+    m_breakpoints[address] = enabled;
+    auto& page = m_pages[address / page_size];
+    if (page) (*page)[address % page_size].breakpoint = enabled;
+}
+
+bool InstructionCache::has_breakpoint(Address_t address) const {
+    return address < m_breakpoints.size() && m_breakpoints[address];
+}
+
+void InstructionCache::clear_breakpoints() {
+    m_breakpoints = {};
+    for (auto& page : m_pages) {
+        if (!page) continue;
+        for (auto& instruction : *page) instruction.breakpoint = false;
+    }
+}
+
+void InstructionCache::copy_breakpoints(const InstructionCache &other) {
+    clear();
+    m_breakpoints = other.m_breakpoints;
+}
+
+void InstructionCache::set_cost_model(const CostModel &cost_model) {
+    clear();
+    m_cost_model = cost_model;
+}
+
+const CostModel &InstructionCache::get_cost_model() const {
+    return m_cost_model;
+}
@@ -0,0 +1,67 @@
+//
+// Created by Lenart on 17/10/2026.
+//
+
+#ifndef ASS2_INSTRUCTIONCACHE_H
+#define ASS2_INSTRUCTIONCACHE_H
+
+#include <array>
+#include <memory>
+#include <vector>
+#include "Memory.h"
+#include "../common/Mnemonics.h"
+#include "../common/Flags.h"
+#include "CostModel.h"
+
+struct DecodedInstruction {
+    Opcode opcode {};
+    Format format {};
+    uint8_t length {};
+    Flags flags {};
+    Register reg_1 {};
+    Register reg_2 {};
+    uint8_t num_2 {};
+    // Target address with PC relative displacement already applied,
+    // base and index registers are added at execution time
+    int32_t operand {};
+    bool valid { false };
+    // Execution breakpoint at this address, kept up to date by the InstructionCache
+    bool breakpoint { false };
+    // Simulated cycles from the cache's cost model
+    uint32_t cycles {};
+
+    static DecodedInstruction decode(const Memory& memory, Address_t address);
+};
+
+class InstructionCache {
+public:
+    explicit InstructionCache(std::shared_ptr<Memory> memory);
+
+    [[nodiscard]] const DecodedInstruction& get(Address_t address);
+    void invalidate(Address_t address, size_t length);
+    void clear();
+
+    void set_breakpoint(Address_t address, bool enabled);
+    [[nodiscard]] bool has_breakpoint(Address_t address) const;
+    void clear_breakpoints();
+    void copy_breakpoints(const InstructionCache& other);
+
+    // Drops the cached instructions, their cycles are taken from the new model
+    void set_cost_model(const CostModel& cost_model);
+    [[nodiscard]] const CostModel& get_cost_model() const;
+
+    static constexpr size_t page_size = 1 << 12;
+    static constexpr size_t page_count = Memory::mem_size / page_size;
+private:
+    using Page = std::array<DecodedInstruction, page_size>;
+
+    std::shared_ptr<Memory> m_memory;
+    std::array<std::unique_ptr<Page>, page_count> m_pages {};
+    DecodedInstruction m_uncached {};
+    // Allocated with the first breakpoint
+    std::vector<bool> m_breakpoints {};
+    CostModel m_cost_model {};
+};
+
+
+#endif //ASS2_INSTRUCTIONCACHE_H
@@ -0,0 +1,456 @@
+//
+// Created by Lenart on 17/10/2026.
+//
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include "LockstepGroup.h"
+#include "Semantics.h"
+
+using semantics::sign_extend;
+
+LockstepGroup::LockstepGroup(const Memory& image, Address_t start_address, uint64_t instruction_limit)
+    : m_image(image)
+    , m_start_address(start_address)
+    , m_instruction_limit(instruction_limit)
+{}
+
+std::vector<BatchResult> LockstepGroup::run(std::span<const BatchJob> jobs) {
+    m_pc = m_start_address;
+    m_active = jobs.size();
+    m_results.assign(jobs.size(), {});
+    m_next_pc.assign(jobs.size(), {});
+    for (auto& lane_register : m_registers) lane_register.assign(jobs.size(), {});
+
+    for (size_t lane = 0; lane < jobs.size(); lane++) {
+        // Pages stay shared with the image until the lane writes to them
+        m_memories.push_back(std::make_shared<Memory>(m_image));
+        m_jobs.push_back(lane);
+
+        auto& devices = m_devices.emplace_back();
+        for (Byte_t id : {0, 1, 2}) devices[id] = std::make_unique<MemoryDevice>();
+        for (auto& [id, input] : jobs[lane].devices) devices[id] = std::make_unique<MemoryDevice>(input);
+    }
+
+    while (m_active > 0) {
+        if (m_instruction_limit != 0 && m_instruction_count >= m_instruction_limit) {
+            for (auto lane = m_active; lane-- > 0;) retire(lane, m_pc, StopReason::Budget);
+            break;
+        }
+
+        auto instruction = decode();
+        if (m_active == 0) break;
+
+        if (!instruction) {
+            for (auto lane = m_active; lane-- > 0;) peel(lane, m_pc);
+            break;
+        }
+
+        execute(*instruction);
+    }
+
+    return std::move(m_results);
+}
+
+const DecodedInstruction* LockstepGroup::decode() {
+    if (m_pc >= Memory::mem_size) return nullptr;
+
+    auto cached = m_decoded.find(m_pc);
+    if (cached == m_decoded.end()) {
+        // Lanes only disagree on code they wrote, lanes that differ from the first one continue alone
+        auto end = std::min<Address_t>(m_pc + 4, Memory::mem_size);
+        for (auto lane = m_active; lane-- > 1;) {
+            for (auto address = m_pc; address < end; address++) {
+                if (m_memories[lane]->get_byte(address) != m_memories[0]->get_byte(address)) {
+                    peel(lane, m_pc);
+                    break;
+                }
+            }
+        }
+
+        cached = m_decoded.emplace(m_pc, DecodedInstruction::decode(*m_memories[0], m_pc)).first;
+        m_decoded_addresses[m_pc] = true;
+    }
+
+    if (!is_supported(cached->second)) return nullptr;
+    return &cached->second;
+}
+
+bool LockstepGroup::is_supported(const DecodedInstruction& instruction) {
+    using enum Opcode;
+    if (!instruction.valid) return false;
+
+    switch (instruction.format) {
+        case Format::F2_reg:
+        case Format::F2_reg_num:
+        case Format::F2_reg_reg: {
+            // PC and CC operands go through the scalar Machine
+            auto lane_register = [](Register reg) { return reg != Register::PC && reg != Register::CC; };
+            if (!lane_register(instruction.reg_1)) return false;
+            if (instruction.format == Format::F2_reg_reg && !lane_register(instruction.reg_2)) return false;
+            return instruction.opcode != SVC;
+        }
+        case Format::F3:
+        case Format::F3_4_mem: {
+            auto op = instruction.opcode;
+            return op != LDF && op != STF && op != ADDF && op != SUBF && op != MULF && op != DIVF &&
+                   op != COMPF && op != LPS && op != STI && op != SSK;
+        }
+        default:
+            return false;
+    }
+}
+
+void LockstepGroup::execute(DecodedInstruction instruction) {
+    using enum Opcode;
+    auto op = instruction.opcode;
+
+    auto next_pc = static_cast<Address_t>(sign_extend(static_cast<Register_t>(m_pc + instruction.length)));
+    m_instruction_count++;
+
+    if (op == J || op == JEQ || op == JGT || op == JLT || op == RSUB || op == JSUB) {
+        execute_jump(instruction, next_pc);
+        return;
+    }
+
+    if (instruction.format == Format::F3 || instruction.format == Format::F3_4_mem) {
+        execute_format3_4(instruction);
+    } else {
+        execute_format2(instruction);
+    }
+    m_pc = next_pc;
+}
+
+void LockstepGroup::execute_format2(const DecodedInstruction& instruction) {
+    using enum Opcode;
+    auto count = m_active;
+    auto r1 = lane_register(instruction.reg_1);
+    auto r2 = lane_register(instruction.reg_2);
+    auto num_2 = instruction.num_2;
+
+    auto register_arithmetic = [&]<Opcode op>() {
+        for (size_t i = 0; i < count; i++) r2[i] = sign_extend(semantics::arithmetic<op>(r1[i], r2[i]));
+    };
+
+    switch (instruction.opcode) {
+        case ADDR: register_arithmetic.template operator()<ADDR>(); break;
+        case SUBR: register_arithmetic.template operator()<SUBR>(); break;
+        case MULR: register_arithmetic.template operator()<MULR>(); break;
+        case DIVR: register_arithmetic.template operator()<DIVR>(); break;
+        case COMPR:
+            for (size_t i = 0; i < count; i++) set_cc(i, r1[i] - r2[i]);
+            break;
+        case SHIFTL:
+            for (size_t i = 0; i < count; i++) r1[i] = sign_extend(semantics::shift_left(r1[i], num_2));
+            break;
+        case SHIFTR:
+            for (size_t i = 0; i < count; i++) r1[i] = sign_extend(semantics::shift_right(r1[i], num_2));
+            break;
+        case RMO:
+            for (size_t i = 0; i < count; i++) r2[i] = r1[i];
+            break;
+        case CLEAR:
+            std::fill_n(r1, count, 0);
+            break;
+        case TIXR: {
+            auto x = lane_register(Register::X);
+            for (size_t i = 0; i < count; i++) {
+                x[i] = sign_extend(x[i] + 1);
+                set_cc(i, x[i] - r1[i]);
+            }
+            break;
+        }
+        default:
+            assert(!"Unsupported lockstep instruction");
+    }
+}
+
+void LockstepGroup::execute_format3_4(const DecodedInstruction& instruction) {
+    using enum Opcode;
+    auto count = m_active;
+    auto& flags = instruction.flags;
+    auto a = lane_register(Register::A);
+    auto x = lane_register(Register::X);
+
+    auto store_word = [&](Register reg) {
+        auto value = lane_register(reg);
+        for (size_t i = 0; i < count; i++) set_word(flags, i, effective_address(instruction, i), value[i]);
+    };
+    auto load_word = [&](Register reg) {
+        auto value = lane_register(reg);
+        for (size_t i = 0; i < count; i++) value[i] = sign_extend(get_word(flags, i, effective_address(instruction, i)));
+    };
+    auto arithmetic = [&]<Opcode op>() {
+        for (size_t i = 0; i < count; i++) {
+            a[i] = sign_extend(semantics::arithmetic<op>(a[i], get_word(flags, i, effective_address(instruction, i))));
+        }
+    };
+
+    switch (instruction.opcode) {
+        case STA: store_word(Register::A); break;
+        case STX: store_word(Register::X); break;
+        case STL: store_word(Register::L); break;
+        case STB: store_word(Register::B); break;
+        case STS: store_word(Register::S); break;
+        case STT: store_word(Register::T); break;
+        case STSW: store_word(Register::SW); break;
+        case STCH:
+            for (size_t i = 0; i < count; i++) set_byte(flags, i, effective_address(instruction, i), a[i]);
+            break;
+        case LDA: load_word(Register::A); break;
+        case LDX: load_word(Register::X); break;
+        case LDL: load_word(Register::L); break;
+        case LDB: load_word(Register::B); break;
+        case LDS: load_word(Register::S); break;
+        case LDT: load_word(Register::T); break;
+        case LDCH:
+            for (size_t i = 0; i < count; i++) {
+                a[i] = sign_extend(semantics::with_low_byte(a[i], get_byte(flags, i, effective_address(instruction, i))));
+            }
+            break;
+        case ADD: arithmetic.template operator()<ADD>(); break;
+        case SUB: arithmetic.template operator()<SUB>(); break;
+        case MUL: arithmetic.template operator()<MUL>(); break;
+        case DIV: arithmetic.template operator()<DIV>(); break;
+        case AND: arithmetic.template operator()<AND>(); break;
+        case OR: arithmetic.template operator()<OR>(); break;
+        case COMP:
+            for (size_t i = 0; i < count; i++) set_cc(i, a[i] - get_word(flags, i, effective_address(instruction, i)));
+            break;
+        case TIX:
+            for (size_t i = 0; i < count; i++) {
+                x[i] = sign_extend(x[i] + 1);
+                set_cc(i, x[i] - get_word(flags, i, effective_address(instruction, i)));
+            }
+            break;
+        case RD:
+            for (size_t i = 0; i < count; i++) {
+                auto device_id = get_byte(flags, i, effective_address(instruction, i));
+                a[i] = sign_extend(semantics::with_low_byte(a[i], lane_device(i, device_id).read()));
+            }
+            break;
+        case WD:
+            for (size_t i = 0; i < count; i++) {
+                auto device_id = get_byte(flags, i, effective_address(instruction, i));
+                lane_device(i, device_id).write(a[i] & 0xff);
+            }
+            break;
+        case TD:
+            for (size_t i = 0; i < count; i++) {
+                auto device_id = get_byte(flags, i, effective_address(instruction, i));
+                auto device = m_devices[i].find(device_id);
+                bool tested = device != m_devices[i].end() && device->second->test();
+                set_cc(i, tested ? 0 : -1);
+            }
+            break;
+        default:
+            assert(!"Unsupported lockstep instruction");
+    }
+}
+
+void LockstepGroup::execute_jump(const DecodedInstruction& instruction, Address_t next_pc) {
+    using enum Opcode;
+    auto count = m_active;
+    auto& flags = instruction.flags;
+    auto sw = lane_register(Register::SW);
+    auto l = lane_register(Register::L);
+
+    auto target = [&](size_t lane) {
+        return resolve_address(flags, lane, effective_address(instruction, lane));
+    };
+    auto jump_pc = [](Address_t address) {
+        return static_cast<Address_t>(sign_extend(static_cast<Register_t>(address)));
+    };
+
+    switch (instruction.opcode) {
+        case JEQ:
+            for (size_t i = 0; i < count; i++) m_next_pc[i] = (sw[i] & 0b1100) == 0b0000 ? jump_pc(target(i)) : next_pc;
+            break;
+        case JGT:
+            for (size_t i = 0; i < count; i++) m_next_pc[i] = (sw[i] & 0b1100) == 0b1000 ? jump_pc(target(i)) : next_pc;
+            break;
+        case JLT:
+            for (size_t i = 0; i < count; i++) m_next_pc[i] = (sw[i] & 0b1100) == 0b0100 ? jump_pc(target(i)) : next_pc;
+            break;
+        case J:
+            for (size_t i = 0; i < count; i++) m_next_pc[i] = target(i);
+            break;
+        case RSUB:
+            for (size_t i = 0; i < count; i++) m_next_pc[i] = jump_pc(l[i]);
+            break;
+        case JSUB:
+            for (size_t i = 0; i < count; i++) {
+                l[i] = sign_extend(static_cast<Register_t>(next_pc));
+                m_next_pc[i] = jump_pc(target(i));
+            }
+            break;
+        default:
+            assert(!"Unsupported lockstep jump");
+    }
+
+    // The group follows most lanes, the rest continue alone
+    auto pc = majority_next_pc();
+    for (auto lane = m_active; lane-- > 0;) {
+        if (m_next_pc[lane] == pc) continue;
+
+        if (instruction.opcode == J && m_next_pc[lane] == next_pc - 3) {
+            retire(lane, jump_pc(m_next_pc[lane]), StopReason::Halted);
+        } else {
+            peel(lane, jump_pc(m_next_pc[lane]));
+        }
+    }
+
+    if (instruction.opcode == J && pc == next_pc - 3) {
+        for (auto lane = m_active; lane-- > 0;) retire(lane, jump_pc(pc), StopReason::Halted);
+        return;
+    }
+
+    m_pc = instruction.opcode == J ? jump_pc(pc) : pc;
+}
+
+Address_t LockstepGroup::majority_next_pc() const {
+    auto begin = m_next_pc.begin();
+    auto end = begin + static_cast<std::ptrdiff_t>(m_active);
+
+    // Diverging lanes mostly split between a jump target and the next instruction,
+    // so each distinct PC is counted once, at the first lane that has it
+    Address_t best = m_next_pc[0];
+    std::ptrdiff_t best_count = 0;
+    for (auto lane = begin; lane != end && best_count * 2 <= end - begin; lane++) {
+        if (std::find(begin, lane, *lane) != lane) continue;
+
+        auto count = std::count(lane, end, *lane);
+        if (count > best_count) {
+            best = *lane;
+            best_count = count;
+        }
+    }
+    return best;
+}
+
+Register_t* LockstepGroup::lane_register(Register reg) {
+    return m_registers[static_cast<size_t>(reg)].data();
+}
+
+Address_t LockstepGroup::effective_address(const DecodedInstruction& instruction, size_t lane) const {
+    int32_t operand = instruction.operand;
+    if (instruction.flags.is_base_relative()) operand += m_registers[static_cast<size_t>(Register::B)][lane];
+    if (instruction.flags.is_indexed()) operand += m_registers[static_cast<size_t>(Register::X)][lane];
+    return operand;
+}
+
+Address_t LockstepGroup::resolve_address(const Flags& flags, size_t lane, Address_t address) const {
+    if (flags.is_indirect()) return m_memories[lane]->get_word(address);
+    return address;
+}
+
+Word_t LockstepGroup::get_word(const Flags& flags, size_t lane, Address_t address) const {
+    if (flags.is_immediate()) return static_cast<Word_t>(address);
+    return m_memories[lane]->get_word(resolve_address(flags, lane, address));
+}
+
+Byte_t LockstepGroup::get_byte(const Flags& flags, size_t lane, Address_t address) const {
+    if (flags.is_immediate()) return static_cast<Byte_t>(address);
+    return m_memories[lane]->get_byte(resolve_address(flags, lane, address));
+}
+
+void LockstepGroup::set_word(const Flags& flags, size_t lane, Address_t address, Word_t value) {
+    address = resolve_address(flags, lane, address);
+    m_memories[lane]->set_word(address, value);
+    invalidate_code(address, 3);
+}
+
+void LockstepGroup::set_byte(const Flags& flags, size_t lane, Address_t address, Byte_t value) {
+    address = resolve_address(flags, lane, address);
+    m_memories[lane]->set_byte(address, value);
+    invalidate_code(address, 1);
+}
+
+void LockstepGroup::set_cc(size_t lane, Register_t value) {
+    auto& sw = m_registers[static_cast<size_t>(Register::SW)][lane];
+    sw = sign_extend(semantics::with_condition_code(sw, value));
+}
+
+MemoryDevice& LockstepGroup::lane_device(size_t lane, Byte_t id) {
+    // Same as the Machine device factory set up by BatchRunner::use_memory_devices
+    auto& device = m_devices[lane][id];
+    if (!device) device = std::make_unique<MemoryDevice>();
+    return *device;
+}
+
+void LockstepGroup::invalidate_code(Address_t address, size_t length) {
+    // Decoded instructions are up to 4 bytes long
+    auto start = address >= 3 ? address - 3 : 0;
+    auto end = std::min<size_t>(address + length, Memory::mem_size);
+
+    for (auto a = start; a < end; a++) {
+        if (!m_decoded_addresses[a]) continue;
+        m_decoded_addresses[a] = false;
+        m_decoded.erase(a);
+    }
+}
+
+BatchResult LockstepGroup::lane_result(size_t lane, Address_t pc) const {
+    BatchResult result {};
+
+    for (size_t reg = 0; reg < register_count; reg++) {
+        if (static_cast<Register>(reg) == Register::PC) continue;
+        result.registers.set(static_cast<Register>(reg), m_registers[reg][lane]);
+    }
+    result.registers.setPc(pc);
+
+    for (auto& [id, device] : m_devices[lane]) {
+        result.devices[id] = device->get_output();
+    }
+    return result;
+}
+
+void LockstepGroup::retire(size_t lane, Address_t pc, StopReason reason) {
+    auto result = lane_result(lane, pc);
+    result.halted = reason == StopReason::Halted;
+    result.instruction_count = m_instruction_count;
+    result.lockstep_instruction_count = m_instruction_count;
+
+    m_results[m_jobs[lane]] = std::move(result);
+    remove_lane(lane);
+}
+
+void LockstepGroup::peel(size_t lane, Address_t pc) {
+    // A lane can diverge on the last instruction of its budget
+    if (m_instruction_limit != 0 && m_instruction_count >= m_instruction_limit) {
+        retire(lane, pc, StopReason::Budget);
+        return;
+    }
+
+    auto registers = lane_result(lane, pc).registers;
+    Machine machine {registers, m_memories[lane], ExecutionEngine::Threaded};
+    machine.set_change_recording(false);
+    machine.set_checkpoint_interval(0);
+
+    std::map<Byte_t, const MemoryDevice*> devices {};
+    for (auto& [id, device] : m_devices[lane]) {
+        devices[id] = device.get();
+        machine.set_device(id, std::move(device));
+    }
+    BatchRunner::use_memory_devices(machine, devices);
+
+    auto limit = m_instruction_limit != 0 ? m_instruction_limit - m_instruction_count : std::numeric_limits<uint64_t>::max();
+    auto result = BatchRunner::run_machine(machine, devices, limit);
+    result.instruction_count += m_instruction_count;
+    result.lockstep_instruction_count = m_instruction_count;
+
+    m_results[m_jobs[lane]] = std::move(result);
+    remove_lane(lane);
+}
+
+void LockstepGroup::remove_lane(size_t lane) {
+    auto last = --m_active;
+    if (lane == last) return;
+
+    for (auto& lane_register : m_registers) std::swap(lane_register[lane], lane_register[last]);
+    std::swap(m_memories[lane], m_memories[last]);
+    std::swap(m_devices[lane], m_devices[last]);
+    std::swap(m_jobs[lane], m_jobs[last]);
+    std::swap(m_next_pc[lane], m_next_pc[last]);
+}
@@ -0,0 +1,78 @@
+//
+// Created by Lenart on 17/10/2026.
+//
+
+#ifndef ASS2_LOCKSTEPGROUP_H
+#define ASS2_LOCKSTEPGROUP_H
+
+#include <array>
+#include <span>
+#include <unordered_map>
+#include <vector>
+#include "BatchRunner.h"
+
+// Runs instances of one program in lockstep while their PCs agree.
+// Registers are kept as one array per register, so every instruction is decoded and dispatched once
+// and then applied to all lanes in a loop. Lanes that jump away from the majority, see different code bytes,
+// or use an instruction the lockstep loop does not handle continue alone on a scalar Machine.
+class LockstepGroup {
+public:
+    LockstepGroup(const Memory& image, Address_t start_address, uint64_t instruction_limit);
+
+    std::vector<BatchResult> run(std::span<const BatchJob> jobs);
+
+private:
+    [[nodiscard]] const DecodedInstruction* decode();
+    [[nodiscard]] static bool is_supported(const DecodedInstruction& instruction);
+
+    void execute(DecodedInstruction instruction);
+    void execute_format2(const DecodedInstruction& instruction);
+    void execute_format3_4(const DecodedInstruction& instruction);
+    void execute_jump(const DecodedInstruction& instruction, Address_t next_pc);
+    // Next PC shared by the most lanes, ties go to the lowest lane
+    [[nodiscard]] Address_t majority_next_pc() const;
+
+    [[nodiscard]] Register_t* lane_register(Register reg);
+    [[nodiscard]] Address_t effective_address(const DecodedInstruction& instruction, size_t lane) const;
+    [[nodiscard]] Address_t resolve_address(const Flags& flags, size_t lane, Address_t address) const;
+    [[nodiscard]] Word_t get_word(const Flags& flags, size_t lane, Address_t address) const;
+    [[nodiscard]] Byte_t get_byte(const Flags& flags, size_t lane, Address_t address) const;
+    void set_word(const Flags& flags, size_t lane, Address_t address, Word_t value);
+    void set_byte(const Flags& flags, size_t lane, Address_t address, Byte_t value);
+    void set_cc(size_t lane, Register_t value);
+    [[nodiscard]] MemoryDevice& lane_device(size_t lane, Byte_t id);
+    void invalidate_code(Address_t address, size_t length);
+
+    [[nodiscard]] BatchResult lane_result(size_t lane, Address_t pc) const;
+    // Finishes the lane without running it further, reason is Halted or Budget
+    void retire(size_t lane, Address_t pc, StopReason reason);
+    // Continues the lane on a scalar Machine for the rest of the instruction budget
+    void peel(size_t lane, Address_t pc);
+    void remove_lane(size_t lane);
+
+    static constexpr size_t register_count = static_cast<size_t>(Register::SW) + 1;
+private:
+    const Memory& m_image;
+    Address_t m_start_address;
+    uint64_t m_instruction_limit;
+
+    Address_t m_pc {};
+    uint64_t m_instruction_count {};
+    size_t m_active {};
+
+    // Per lane state, the first m_active entries are still in lockstep
+    std::array<std::vector<Register_t>, register_count> m_registers {};
+    std::vector<std::shared_ptr<Memory>> m_memories {};
+    std::vector<std::map<Byte_t, std::unique_ptr<MemoryDevice>>> m_devices {};
+    std::vector<size_t> m_jobs {};
+    std::vector<Address_t> m_next_pc {};
+
+    // Instructions decoded once all lanes agreed on their bytes, dropped when any lane writes to them
+    std::unordered_map<Address_t, DecodedInstruction> m_decoded {};
+    std::vector<bool> m_decoded_addresses = std::vector<bool>(Memory::mem_size);
+
+    std::vector<BatchResult> m_results {};
+};
+
+
+#endif //ASS2_LOCKSTEPGROUP_H
@@ -2,15 +2,23 @@
 // Created by Lenart on 12/11/2022.
 //
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <iostream>
+#include <limits>
 #include <memory>
+#include <type_traits>
 #include <utility>
 #include "Machine.h"
+#include "Semantics.h"
 #include "../common/Flags.h"
 
-Machine::Machine(Address_t start_address, std::shared_ptr<Memory> memory)
+Machine::Machine(Address_t start_address, std::shared_ptr<Memory> memory, ExecutionEngine engine)
     : m_memory(std::move(memory))
+    , m_instruction_cache(m_memory)
+    , m_engine(engine)
+    , m_device_factory([](Byte_t id, bool for_write) { return std::make_unique<FileDevice>(id, for_write); })
 {
     m_registers.setPc(start_address);
     m_devices[0] = std::make_unique<StdinDevice>();
@@ -18,7 +26,46 @@ Machine::Machine(Address_t start_address, std::shared_ptr<Memory> memory)
     m_devices[2] = std::make_unique<StderrDevice>();
 }
 
+Machine::Machine(const Registers& registers, std::shared_ptr<Memory> memory, ExecutionEngine engine)
+    : Machine(registers.getPc(), std::move(memory), engine)
+{
+    m_registers = registers;
+}
+
+std::unique_ptr<Machine> Machine::fork() {
+    auto child = std::make_unique<Machine>(m_registers, std::make_shared<Memory>(*m_memory), m_engine);
+    child->m_halted = m_halted;
+    child->m_instruction_cache.copy_breakpoints(m_instruction_cache);
+    child->m_instruction_cache.set_cost_model(m_instruction_cache.get_cost_model());
+    child->m_watchpoints = m_watchpoints;
+    child->m_watched_pages = m_watched_pages;
+
+    for (size_t id = 0; id < m_devices.size(); id++) {
+        child->m_devices[id] = m_devices[id] ? m_devices[id]->clone() : nullptr;
+    }
+    child->m_device_factory = m_device_factory;
+    child->m_device_events.assign(m_device_events.begin(), m_device_events.begin() + m_device_event_index);
+    child->m_device_logging = m_device_logging;
+    child->m_device_event_index = m_device_event_index;
+    child->m_device_events_performed = m_device_event_index;
+
+    child->m_changes = m_changes;
+    child->m_record_changes = m_record_changes;
+
+    // Checkpoints past the current instruction belong to the parent's future
+    child->m_instruction_count = m_instruction_count;
+    child->m_cycle_count = m_cycle_count;
+    for (auto& checkpoint : m_checkpoints) {
+        if (checkpoint.instruction_count > m_instruction_count) break;
+        child->m_checkpoints.push_back(checkpoint);
+    }
+    child->set_checkpoint_interval(m_checkpoint_interval);
+
+    return child;
+}
+
 void Machine::step() {
+    m_watch_hit.reset();
     execute();
 }
 
@@ -31,10 +78,18 @@ void Machine::undo() {
             m_registers.undo(std::get<RegisterChange>(change));
         }
         else if (std::holds_alternative<MemoryChange>(change)) {
-            m_memory->undo(std::get<MemoryChange>(change));
+            auto& memory_change = std::get<MemoryChange>(change);
+            m_memory->undo(memory_change);
+            invalidate_code(memory_change.start_address, memory_change.changed_bytes_length);
         }
         else if (std::holds_alternative<ChangeStart>(change)) {
             m_halted = false;
+            m_instruction_count--;
+            m_cycle_count -= std::get<ChangeStart>(change).cycles;
+            while (m_device_event_index > 0 &&
+                   m_device_events[m_device_event_index - 1].instruction_count > m_instruction_count) {
+                m_device_event_index--;
+            }
             break;
         }
         else {
@@ -46,36 +101,54 @@ void Machine::undo() {
 void Machine::execute() {
     if (m_halted) return;
 
-    add_change_step(ChangeStart{m_registers.getPc()});
-
-    uint8_t b0 = fetch();
+    execute(m_instruction_cache.get(m_registers.getPc()));
+}
 
-    if (execute_format1(b0)) return;
+void Machine::execute(const DecodedInstruction& instruction) {
+    if (m_instruction_count >= m_next_checkpoint) take_checkpoint();
+    if (m_stats.instructions >= m_next_stats_dump) dump_stats();
+    m_stats.instructions++;
+    if (instruction.length - 1u < m_stats.format_instructions.size()) m_stats.format_instructions[instruction.length - 1]++;
 
-    uint8_t b1 = fetch();
-    if (execute_format2(b0, b1)) return;
+    auto pc = m_registers.getPc();
+    if (m_profiling) m_profiler->count_execution(pc);
+    if (m_tracing) m_trace->record_instruction(pc, *m_memory, instruction.length);
+    if (m_caching) m_icache->access(pc, instruction.length);
+    add_change_step(ChangeStart{pc, instruction.cycles});
+    m_instruction_count++;
+    m_cycle_count += instruction.cycles;
+    add_change_step(m_registers.setPc(pc + instruction.length));
 
-    uint8_t b2 = fetch();
-    if (execute_format3_4(b0, b1, b2)) return;
+    if (m_engine != ExecutionEngine::Interpreter) {
+        auto handler = instruction.valid
+                ? threaded_handlers[static_cast<uint8_t>(instruction.opcode) >> 2]
+                : &Machine::execute_invalid;
+        (this->*handler)(instruction);
+        return;
+    }
 
-    assert(!"Can't parse instruction");
-}
+    if (!instruction.valid) {
+        execute_invalid(instruction);
+        return;
+    }
 
-bool Machine::execute_format1(uint8_t b0) {
-    auto op = static_cast<Opcode>(b0 & 0b11111100);
-    switch (op) {
-        case Opcode::FLOAT:
-        case Opcode::FIX:
-        case Opcode::NORM:
-        case Opcode::SIO:
-        case Opcode::HIO:
-        case Opcode::TIO:
-            not_implemented(op);
+    switch (instruction.format) {
+        case Format::F1:
+            execute_format1(instruction);
+            break;
+        case Format::F2_num:
+        case Format::F2_reg:
+        case Format::F2_reg_num:
+        case Format::F2_reg_reg:
+            execute_format2(instruction);
+            break;
+        case Format::F3:
+        case Format::F3_4_mem:
+            execute_format3_4(instruction);
             break;
         default:
-            return false;
+            execute_invalid(instruction);
     }
-    return true;
 }
 
 void Machine::set_register(Register reg, Register_t new_value) {
@@ -84,286 +157,401 @@ void Machine::set_register(Register reg, Register_t new_value) {
 
 void Machine::set_word(const Flags &flags, Address_t address, Word_t new_value) {
     address = resolve_address(flags, address);
-    add_change_step(m_memory->set_word(address, new_value));
+    auto change = m_memory->set_word(address, new_value);
+    m_stats.memory_writes++;
+    if (m_profiling) m_profiler->count_write(address);
+    if (m_caching) m_dcache->access(address, 3);
+    if (is_watched(address, 3)) {
+        check_watchpoints(WatchKind::Write, address, 3, change.previous_value, change.new_value);
+    }
+    add_change_step(change);
+    invalidate_code(address, 3);
 }
 
 Word_t Machine::get_word(const Flags &flags, Address_t address) {
     if (flags.is_immediate()) return static_cast<Word_t>(address);
     address = resolve_address(flags, address);
-    return m_memory->get_word(address);
+    auto word = m_memory->get_word(address);
+    m_stats.memory_reads++;
+    if (m_profiling) m_profiler->count_read(address);
+    if (m_caching) m_dcache->access(address, 3);
+    if (is_watched(address, 3)) check_watchpoints(WatchKind::Read, address, 3, word, word);
+    return word;
 }
 
 void Machine::set_byte(const Flags &flags, Address_t address, Byte_t new_value) {
     address = resolve_address(flags, address);
-    add_change_step(m_memory->set_byte(address, new_value));
+    auto change = m_memory->set_byte(address, new_value);
+    m_stats.memory_writes++;
+    if (m_profiling) m_profiler->count_write(address);
+    if (m_caching) m_dcache->access(address, 1);
+    if (is_watched(address, 1)) {
+        check_watchpoints(WatchKind::Write, address, 1, change.previous_value, change.new_value);
+    }
+    add_change_step(change);
+    invalidate_code(address, 1);
 }
 
 Byte_t Machine::get_byte(const Flags &flags, Address_t address) {
     if (flags.is_immediate()) return static_cast<Byte_t>(address);
     address = resolve_address(flags, address);
-    return m_memory->get_byte(address);
+    auto byte = m_memory->get_byte(address);
+    m_stats.memory_reads++;
+    if (m_profiling) m_profiler->count_read(address);
+    if (m_caching) m_dcache->access(address, 1);
+    if (is_watched(address, 1)) check_watchpoints(WatchKind::Read, address, 1, byte, byte);
+    return byte;
 }
 
 
 Address_t Machine::resolve_address(const Flags &flags, Address_t address) {
-    if (flags.is_indirect())
-        return m_memory->get_word(address);
+    if (flags.is_indirect()) {
+        auto indirect_address = m_memory->get_word(address);
+        m_stats.memory_reads++;
+        if (m_profiling) m_profiler->count_read(address);
+        if (m_caching) m_dcache->access(address, 3);
+        if (is_watched(address, 3)) check_watchpoints(WatchKind::Read, address, 3, indirect_address, indirect_address);
+        return indirect_address;
+    }
     return address;
 }
 
+void Machine::conditional_jump(const DecodedInstruction& instruction, Address_t address, bool taken) {
+    if (m_profiling) m_profiler->count_branch(m_registers.getPc() - instruction.length, taken);
+    if (taken) set_register(Register::PC, resolve_address(instruction.flags, address));
+}
 
-bool Machine::execute_format2(uint8_t b0, uint8_t b1) {
-    auto op = static_cast<Opcode>(b0 & 0b11111100);
-    auto num_1 = (b1 & 0xF0) >> 4;
-    auto num_2 = (b1 & 0x0F);
-    auto reg_1 = static_cast<Register>(num_1);
-    auto reg_2 = static_cast<Register>(num_2);
+bool Machine::is_watched(Address_t address, size_t length) const {
+    auto first_page = address >> Memory::page_bits;
+    auto last_page = (address + length - 1) >> Memory::page_bits;
+    if (last_page >= m_watched_pages.size()) return false;
+    return m_watched_pages[first_page] || m_watched_pages[last_page];
+}
 
-    switch (op) {
-        case Opcode::ADDR:
-            set_register(reg_2, m_registers.get(reg_1) + m_registers.get(reg_2));
-            break;
-        case Opcode::SUBR:
-            set_register(reg_2, m_registers.get(reg_1) - m_registers.get(reg_2));
-            break;
-        case Opcode::MULR:
-            set_register(reg_2, m_registers.get(reg_1) * m_registers.get(reg_2));
-            break;
-        case Opcode::DIVR:
-            set_register(reg_2, m_registers.get(reg_1) / m_registers.get(reg_2));
-            break;
-        case Opcode::COMPR:
-            set_register(Register::CC, m_registers.get(reg_1) - m_registers.get(reg_2));
-            break;
-        case Opcode::SHIFTL: {
-            auto reg = m_registers.get(reg_1);
-            auto rotated_left = (reg << (num_2 + 1) | ((reg & 0x800000) > 0));
-            set_register(reg_1, rotated_left);
-        }
-        case Opcode::SHIFTR: {
-            auto reg = m_registers.get(reg_1);
-            auto rotated_right = (reg >> (num_2 + 1) | ((reg & 1) << 23));
-            set_register(reg_1, rotated_right);
-        }
-        case Opcode::RMO:
-            set_register(reg_2, m_registers.get(reg_1));
-            break;
-        case Opcode::CLEAR:
-            set_register(reg_1, {});
-            break;
-        case Opcode::TIXR:
-            set_register(Register::X, m_registers.getX() + 1);
-            set_register(Register::CC, m_registers.getX() - m_registers.get(reg_1));
-            break;
-        case Opcode::SVC:
-            not_implemented(Opcode::SVC);
-            break;
+void Machine::check_watchpoints(WatchKind access, Address_t address, uint8_t length,
+                                uint32_t previous_value, uint32_t new_value) {
+    auto value_mask = length == 1 ? 0xffu : 0xffffffu;
+
+    for (auto& watchpoint : m_watchpoints) {
+        if (address >= watchpoint.start_address + watchpoint.length ||
+            address + length <= watchpoint.start_address) continue;
+
+        bool hit = watchpoint.kind == access ||
+                   (watchpoint.kind == WatchKind::Change && access == WatchKind::Write &&
+                    ((previous_value ^ new_value) & value_mask));
+        if (!hit) continue;
+
+        m_stop_events |= stop_on(StopReason::Watchpoint);
+        m_watch_hit = WatchHit {
+            .kind = watchpoint.kind,
+            .address = address,
+            .length = length,
+            .previous_value = previous_value & value_mask,
+            .new_value = new_value & value_mask
+        };
+        return;
+    }
+}
+
+
+#define instruction_case(op) case Opcode::op: execute_instruction<Opcode::op>(instruction); break;
+void Machine::execute_format1(const DecodedInstruction& instruction) {
+    switch (instruction.opcode) {
+        instruction_case(FLOAT)
+        instruction_case(FIX)
+        instruction_case(NORM)
+        instruction_case(SIO)
+        instruction_case(HIO)
+        instruction_case(TIO)
         default:
-            return false;
+            execute_invalid(instruction);
     }
-    return true;
+}
+
+void Machine::execute_format2(const DecodedInstruction& instruction) {
+    switch (instruction.opcode) {
+        instruction_case(ADDR)
+        instruction_case(SUBR)
+        instruction_case(MULR)
+        instruction_case(DIVR)
+        instruction_case(COMPR)
+        instruction_case(SHIFTL)
+        instruction_case(SHIFTR)
+        instruction_case(RMO)
+        instruction_case(CLEAR)
+        instruction_case(TIXR)
+        instruction_case(SVC)
+        default:
+            execute_invalid(instruction);
+    }
+}
+
+void Machine::execute_format3_4(const DecodedInstruction& instruction) {
+    switch (instruction.opcode) {
+        instruction_case(STA)
+        instruction_case(STX)
+        instruction_case(STL)
+        instruction_case(STCH)
+        instruction_case(STB)
+        instruction_case(STS)
+        instruction_case(STT)
+        instruction_case(STSW)
+        instruction_case(JEQ)
+        instruction_case(JGT)
+        instruction_case(JLT)
+        instruction_case(J)
+        instruction_case(RSUB)
+        instruction_case(JSUB)
+        instruction_case(LDA)
+        instruction_case(LDX)
+        instruction_case(LDL)
+        instruction_case(LDCH)
+        instruction_case(LDB)
+        instruction_case(LDS)
+        instruction_case(LDT)
+        instruction_case(ADD)
+        instruction_case(SUB)
+        instruction_case(MUL)
+        instruction_case(DIV)
+        instruction_case(AND)
+        instruction_case(OR)
+        instruction_case(COMP)
+        instruction_case(TIX)
+        instruction_case(RD)
+        instruction_case(WD)
+        instruction_case(TD)
+        instruction_case(LDF)
+        instruction_case(STF)
+        instruction_case(ADDF)
+        instruction_case(SUBF)
+        instruction_case(MULF)
+        instruction_case(DIVF)
+        instruction_case(COMPF)
+        instruction_case(LPS)
+        instruction_case(STI)
+        instruction_case(SSK)
+        default:
+            execute_invalid(instruction);
+    }
+}
+#undef instruction_case
+
+void Machine::execute_invalid(const DecodedInstruction&) {
+    assert(!"Can't parse instruction");
 }
 
 #pragma clang diagnostic push
 #pragma ide diagnostic ignored "cppcoreguidelines-narrowing-conversions"
-bool Machine::execute_format3_4(uint8_t b0, uint8_t b1, uint8_t b2) {
-    auto op = static_cast<Opcode>(b0 & 0b11111100);
+template<Opcode op>
+void Machine::execute_instruction(const DecodedInstruction& instruction) {
+    using enum Opcode;
 
-    Flags flags{b0, static_cast<uint8_t>(b1 >> 4)};
+    auto& flags = instruction.flags;
+    auto num_2 = instruction.num_2;
+    auto reg_1 = instruction.reg_1;
+    auto reg_2 = instruction.reg_2;
 
-    if (!flags.is_valid()) return false;
+    int32_t operand = instruction.operand;
 
-    int32_t operand;
-
-    // Standard SIC
-    if (flags.is_sic()) {
-        operand = ((b1 & 0x7F) << 8) | b2;
+    if (flags.is_base_relative()) {
+        operand += m_registers.getB();
     }
-        // F4
-    else if (flags.is_extended()) {
-        uint8_t b3 = fetch();
-        operand = (b1 & 0x0F) << 16 | b2 << 8 | b3;
+
+    if (flags.is_indexed()) {
+        operand += m_registers.getX();
     }
-        // F3
-    else {
-        operand = (b1 & 0x0F) << 8 | b2;
 
-        if (flags.is_pc_relative()) {
-            operand = operand >= 2048 ? operand - 4096 : operand;
-            operand += m_registers.getPc();
-        } else if (flags.is_base_relative()) {
-            operand += m_registers.getB();
-        }
+    // Format 1
+    if constexpr (op == FLOAT || op == FIX || op == NORM || op == SIO || op == HIO || op == TIO) {
+        not_implemented(op);
+    }
+    // Format 2
+    else if constexpr (op == ADDR) {
+        set_register(reg_2, semantics::arithmetic<op>(m_registers.get(reg_1), m_registers.get(reg_2)));
+    }
+    else if constexpr (op == SUBR) {
+        set_register(reg_2, semantics::arithmetic<op>(m_registers.get(reg_1), m_registers.get(reg_2)));
+    }
+    else if constexpr (op == MULR) {
+        set_register(reg_2, semantics::arithmetic<op>(m_registers.get(reg_1), m_registers.get(reg_2)));
+    }
+    else if constexpr (op == DIVR) {
+        set_register(reg_2, semantics::arithmetic<op>(m_registers.get(reg_1), m_registers.get(reg_2)));
+    }
+    else if constexpr (op == COMPR) {
+        set_register(Register::CC, m_registers.get(reg_1) - m_registers.get(reg_2));
+    }
+    else if constexpr (op == SHIFTL) {
+        set_register(reg_1, semantics::shift_left(m_registers.get(reg_1), num_2));
+    }
+    else if constexpr (op == SHIFTR) {
+        set_register(reg_1, semantics::shift_right(m_registers.get(reg_1), num_2));
+    }
+    else if constexpr (op == RMO) {
+        set_register(reg_2, m_registers.get(reg_1));
+    }
+    else if constexpr (op == CLEAR) {
+        set_register(reg_1, {});
     }
+    else if constexpr (op == TIXR) {
+        set_register(Register::X, m_registers.getX() + 1);
+        set_register(Register::CC, m_registers.getX() - m_registers.get(reg_1));
+    }
+    else if constexpr (op == SVC) {
+        not_implemented(SVC);
+    }
+    // Format 3/4
+    else if constexpr (op == STA) {
+        set_word(flags, operand, m_registers.getA());
+    }
+    else if constexpr (op == STX) {
+        set_word(flags, operand, m_registers.getX());
+    }
+    else if constexpr (op == STL) {
+        set_word(flags, operand, m_registers.getL());
+    }
+    else if constexpr (op == STCH) {
+        set_byte(flags, operand, m_registers.getA());
+    }
+    else if constexpr (op == STB) {
+        set_word(flags, operand, m_registers.getB());
+    }
+    else if constexpr (op == STS) {
+        set_word(flags, operand, m_registers.getS());
+    }
+    else if constexpr (op == STT) {
+        set_word(flags, operand, m_registers.getT());
+    }
+    else if constexpr (op == STSW) {
+        set_word(flags, operand, m_registers.getSw());
+    }
+    else if constexpr (op == JEQ) {
+        conditional_jump(instruction, operand, m_registers.CC_is_equal());
+    }
+    else if constexpr (op == JGT) {
+        conditional_jump(instruction, operand, m_registers.CC_is_greater());
+    }
+    else if constexpr (op == JLT) {
+        conditional_jump(instruction, operand, m_registers.CC_is_lower());
+    }
+    else if constexpr (op == J) {
+        auto new_address= resolve_address(flags, operand);
+        m_halted = new_address == m_registers.getPc() - 3;
+        if (m_halted) {
+            flush_devices();
+            m_stop_events |= stop_on(StopReason::Halted);
+        }
+        if (m_profiling) m_profiler->count_jump(new_address);
 
-    if (flags.is_indexed()) {
-        operand += m_registers.getX();
+        set_register(Register::PC, new_address);
+    }
+    else if constexpr (op == RSUB) {
+        if (m_profiling) m_profiler->count_return(m_registers.getL());
+        set_register(Register::PC, m_registers.getL());
+    }
+    else if constexpr (op == JSUB) {
+        auto target_address = resolve_address(flags, operand);
+        if (m_profiling) m_profiler->count_call(target_address, m_registers.getPc());
+        set_register(Register::L, m_registers.getPc());
+        set_register(Register::PC, target_address);
+    }
+    else if constexpr (op == LDA) {
+        set_register(Register::A, get_word(flags, operand));
+    }
+    else if constexpr (op == LDX) {
+        set_register(Register::X, get_word(flags, operand));
+    }
+    else if constexpr (op == LDL) {
+        set_register(Register::L, get_word(flags, operand));
+    }
+    else if constexpr (op == LDCH) {
+        set_register(Register::A, semantics::with_low_byte(m_registers.getA(), get_byte(flags, operand)));
+    }
+    else if constexpr (op == LDB) {
+        set_register(Register::B, get_word(flags, operand));
     }
+    else if constexpr (op == LDS) {
+        set_register(Register::S, get_word(flags, operand));
+    }
+    else if constexpr (op == LDT) {
+        set_register(Register::T, get_word(flags, operand));
+    }
+    else if constexpr (op == ADD || op == SUB || op == MUL || op == DIV || op == AND || op == OR) {
+        set_register(Register::A, semantics::arithmetic<op>(m_registers.getA(), get_word(flags, operand)));
+    }
+    else if constexpr (op == COMP) {
+        set_register(Register::CC,m_registers.getA() - get_word(flags, operand));
+    }
+    else if constexpr (op == TIX) {
+        set_register(Register::X, m_registers.getX() + 1);
+        set_register(Register::CC, m_registers.getX() - get_word(flags, operand));
+    }
+    else if constexpr (op == RD) {
+        auto device_id = get_byte(flags, operand);
 
-    switch (op) {
-        case Opcode::STA:
-            set_word(flags, operand, m_registers.getA());
-            break;
-        case Opcode::STX:
-            set_word(flags, operand, m_registers.getX());
-            break;
-        case Opcode::STL:
-            set_word(flags, operand, m_registers.getL());
-            break;
-        case Opcode::STCH:
-            set_byte(flags, operand, m_registers.getA());
-            break;
-        case Opcode::STB:
-            set_word(flags, operand, m_registers.getB());
-            break;
-        case Opcode::STS:
-            set_word(flags, operand, m_registers.getS());
-            break;
-        case Opcode::STT:
-            set_word(flags, operand, m_registers.getT());
-            break;
-        case Opcode::STSW:
-            set_word(flags, operand, m_registers.getSw());
-            break;
-        case Opcode::JEQ:
-            if (m_registers.CC_is_equal()) set_register(Register::PC, resolve_address(flags, operand));
-            break;
-        case Opcode::JGT:
-            if (m_registers.CC_is_greater()) set_register(Register::PC, resolve_address(flags, operand));
-            break;
-        case Opcode::JLT:
-            if (m_registers.CC_is_lower()) set_register(Register::PC, resolve_address(flags, operand));
-            break;
-        case Opcode::J: {
-            auto new_address= resolve_address(flags, operand);
-            m_halted = new_address == m_registers.getPc() - 3;
+        m_stats.device_reads++;
+        auto ch = device_event(DeviceAccess::Read, device_id, [&] {
+            auto device = get_device(device_id, false);
+            return device ? device->read() : Byte_t {};
+        });
 
-            set_register(Register::PC, new_address);
-            break;
-        }
-        case Opcode::RSUB:
-            set_register(Register::PC, m_registers.getL());
-            break;
-        case Opcode::JSUB:
-            set_register(Register::L, m_registers.getPc());
-            set_register(Register::PC, resolve_address(flags, operand));
-            break;
-        case Opcode::LDA:
-            set_register(Register::A, get_word(flags, operand));
-            break;
-        case Opcode::LDX:
-            set_register(Register::X, get_word(flags, operand));
-            break;
-        case Opcode::LDL:
-            set_register(Register::L, get_word(flags, operand));
-            break;
-        case Opcode::LDCH: {
-            auto reg_A = m_registers.getA();
-            auto ch = get_byte(flags, operand);
-            reg_A = reg_A & 0xffff00 | ch;
-            set_register(Register::A, reg_A);
-            break;
-        }
-        case Opcode::LDB:
-            set_register(Register::B, get_word(flags, operand));
-            break;
-        case Opcode::LDS:
-            set_register(Register::S, get_word(flags, operand));
-            break;
-        case Opcode::LDT:
-            set_register(Register::T, get_word(flags, operand));
-            break;
-        case Opcode::ADD:
-            set_register(Register::A, m_registers.getA() + get_word(flags, operand));
-            break;
-        case Opcode::SUB:
-            set_register(Register::A, m_registers.getA() - get_word(flags, operand));
-            break;
-        case Opcode::MUL:
-            set_register(Register::A, m_registers.getA() * get_word(flags, operand));
-            break;
-        case Opcode::DIV:
-            set_register(Register::A, m_registers.getA() / get_word(flags, operand));
-            break;
-        case Opcode::AND:
-            set_register(Register::A, m_registers.getA() & get_word(flags, operand));
-            break;
-        case Opcode::OR:
-            set_register(Register::A, m_registers.getA() | get_word(flags, operand));
-            break;
-        case Opcode::COMP:
-            set_register(Register::CC,m_registers.getA() - get_word(flags, operand));
-            break;
-        case Opcode::TIX:
-            set_register(Register::X, m_registers.getX() + 1);
-            set_register(Register::CC, m_registers.getX() - get_word(flags, operand));
-            break;
-        case Opcode::RD: {
-            auto device_id = get_byte(flags, operand);
+        set_register(Register::A, semantics::with_low_byte(m_registers.getA(), ch));
+    }
+    else if constexpr (op == WD) {
+        auto device_id = get_byte(flags, operand);
+        auto reg_A = m_registers.getA();
 
-            if (!m_devices.contains(device_id)) {
-                m_devices[device_id] = std::make_unique<FileDevice>(device_id, false);
-            }
+        m_stats.device_writes++;
+        device_event(DeviceAccess::Write, device_id, [&] {
+            auto device = get_device(device_id, true);
+            if (device) device->write(reg_A & 0xff);
+            return static_cast<Byte_t>(reg_A & 0xff);
+        });
+    }
+    else if constexpr (op == TD) {
+        auto device_id = get_byte(flags, operand);
 
+        m_stats.device_tests++;
+        bool tested = device_event(DeviceAccess::Test, device_id, [&] {
             auto& device = m_devices[device_id];
+            return device && device->test();
+        });
+        if (!tested) m_stop_events |= stop_on(StopReason::DeviceWait);
 
-            auto reg_A = m_registers.getA();
-            auto ch = device->read();
-            reg_A = reg_A & 0xffff00 | ch;
-            set_register(Register::A, reg_A);
-            break;
-        }
-        case Opcode::WD: {
-            auto device_id = get_byte(flags, operand);
-            if (!m_devices.contains(device_id)) {
-                m_devices[device_id] = std::make_unique<FileDevice>(device_id, true);
-            }
+        set_register(Register::CC, tested ? 0 : -1);
+    }
+    else if constexpr (op == LDF || op == STF || op == ADDF || op == SUBF || op == MULF || op == DIVF ||
+                       op == COMPF || op == LPS || op == STI || op == SSK) {
+        not_implemented(op);
+    }
+    else {
+        execute_invalid(instruction);
+    }
+}
+#pragma clang diagnostic pop
 
-            auto& device = m_devices[device_id];
+const std::array<Machine::InstructionHandler, 64> Machine::threaded_handlers = [] {
+    std::array<InstructionHandler, 64> handlers {};
+    handlers.fill(&Machine::execute_invalid);
 
-            auto reg_A = m_registers.getA();
-            device->write(reg_A & 0xff);
-            std::cout << std::flush;
-            break;
-        }
-        case Opcode::TD: {
-            auto device_id = get_byte(flags, operand);
+#define handler(op) handlers[static_cast<uint8_t>(Opcode::op) >> 2] = &Machine::execute_instruction<Opcode::op>;
+    handler(FLOAT) handler(FIX) handler(NORM) handler(SIO) handler(HIO) handler(TIO)
 
-            bool tested = false;
-            if (m_devices.contains(device_id)) {
-                auto& device = m_devices[device_id];
-                tested = device->test();
-            }
+    handler(ADDR) handler(SUBR) handler(MULR) handler(DIVR) handler(COMPR) handler(SHIFTL)
+    handler(SHIFTR) handler(RMO) handler(CLEAR) handler(TIXR) handler(SVC)
 
-            set_register(Register::CC, tested ? 0 : -1);
-            break;
-        }
-        case Opcode::LDF:
-        case Opcode::STF:
-        case Opcode::ADDF:
-        case Opcode::SUBF:
-        case Opcode::MULF:
-        case Opcode::DIVF:
-        case Opcode::COMPF:
-        case Opcode::LPS:
-        case Opcode::STI:
-        case Opcode::SSK:
-            not_implemented(op);
-            break;
-        default:
-            return false;
-    }
+    handler(STA) handler(STX) handler(STL) handler(STCH) handler(STB) handler(STS) handler(STT)
+    handler(STSW) handler(JEQ) handler(JGT) handler(JLT) handler(J) handler(RSUB) handler(JSUB)
+    handler(LDA) handler(LDX) handler(LDL) handler(LDCH) handler(LDB) handler(LDS) handler(LDT)
+    handler(ADD) handler(SUB) handler(MUL) handler(DIV) handler(AND) handler(OR) handler(COMP)
+    handler(TIX) handler(RD) handler(WD) handler(TD) handler(LDF) handler(STF) handler(ADDF)
+    handler(SUBF) handler(MULF) handler(DIVF) handler(COMPF) handler(LPS) handler(STI) handler(SSK)
+#undef handler
 
-    return true;
-}
-#pragma clang diagnostic pop
+    return handlers;
+}();
 
 
-uint8_t Machine::fetch() {
-    auto pc = m_registers.getPc();
-    add_change_step(m_registers.setPc(pc + 1));
-    return m_memory->get_byte(pc);
-}
 
 void Machine::not_implemented(Opcode opcode) {
     auto instruction = get_instruction_mnemonic(opcode);
@@ -373,29 +561,40 @@ void Machine::not_implemented(Opcode opcode) {
     assert(!"Instruction not implemented");
 }
 
-void Machine::add_change_step(Machine::Change_t change) {
-    if (!m_changes.empty() && std::holds_alternative<RegisterChange>(m_changes.back()) && std::holds_alternative<RegisterChange>(change) ) {
-        auto& register_change = std::get<RegisterChange>(change);
-        auto& last_register_change = std::get<RegisterChange>(m_changes.back());
-
-        if (register_change.register_id == last_register_change.register_id) {
-            last_register_change.new_value = register_change.new_value;
-            return;
-        }
+template<class Change>
+void Machine::add_change_step(const Change& change) {
+    if constexpr (!std::is_same_v<Change, ChangeStart>) {
+        if (m_tracing) m_trace->record(change);
     }
+    if (!m_record_changes) return;
 
-    m_changes.push_back(change);
-    if (m_changes.size() >= max_changes) {
-        do {
-            m_changes.pop_front();
-        } while (!m_changes.empty() && !std::holds_alternative<ChangeStart>(m_changes.at(0)));
-    }
+    m_changes.push(change);
 }
 
 bool Machine::in_halt_condition() const {
     return m_halted;
 }
 
+void Machine::flush_devices() {
+    for (auto& device : m_devices) {
+        if (device) device->flush();
+    }
+}
+
+void Machine::set_device(Byte_t id, std::unique_ptr<Device> device) {
+    m_devices[id] = std::move(device);
+}
+
+void Machine::set_device_factory(DeviceFactory factory) {
+    m_device_factory = std::move(factory);
+}
+
+Device* Machine::get_device(Byte_t id, bool for_write) {
+    auto& device = m_devices[id];
+    if (!device && m_device_factory) device = m_device_factory(id, for_write);
+    return device.get();
+}
+
 const Registers &Machine::get_registers() const {
     return m_registers;
 }
@@ -408,28 +607,637 @@ bool Machine::can_undo() {
     return !m_changes.empty();
 }
 
+void Machine::set_change_recording(bool enabled) {
+    if (!enabled) m_changes.clear();
+    m_record_changes = enabled;
+}
+
+bool Machine::is_recording_changes() const {
+    return m_record_changes;
+}
+
+void Machine::set_watchpoint(Address_t address, size_t length, WatchKind kind) {
+    if (length == 0) return;
+
+    m_watchpoints.push_back({ .start_address = address, .length = length, .kind = kind });
+
+    auto end = std::min<size_t>(address + length, Memory::mem_size);
+    for (size_t page = address >> Memory::page_bits; page < m_watched_pages.size() && page << Memory::page_bits < end; page++) {
+        m_watched_pages[page] = true;
+    }
+}
+
+void Machine::clear_watchpoint(Address_t address) {
+    std::erase_if(m_watchpoints, [&](const Watchpoint& watchpoint) {
+        return watchpoint.start_address == address;
+    });
+
+    std::fill(m_watched_pages.begin(), m_watched_pages.end(), false);
+    auto watchpoints = std::move(m_watchpoints);
+    m_watchpoints.clear();
+    for (auto& watchpoint : watchpoints) {
+        set_watchpoint(watchpoint.start_address, watchpoint.length, watchpoint.kind);
+    }
+}
+
+void Machine::clear_watchpoints() {
+    m_watchpoints.clear();
+    std::fill(m_watched_pages.begin(), m_watched_pages.end(), false);
+}
+
+const std::optional<WatchHit>& Machine::get_watch_hit() const {
+    return m_watch_hit;
+}
+
+void Machine::set_profiling(bool enabled) {
+    if (enabled && !m_profiling) m_profiler = std::make_unique<Profiler>(m_registers.getPc());
+    m_profiling = enabled;
+}
+
+bool Machine::is_profiling() const {
+    return m_profiling;
+}
+
+const Profiler* Machine::get_profile() const {
+    return m_profiler.get();
+}
+
+MachineStats Machine::get_stats() const {
+    auto stats = m_stats;
+    stats.journal_bytes = (m_changes.get_pushed_record_count() - m_journal_records_at_reset) * sizeof(uint64_t);
+    if (m_run_start) {
+        stats.run_instructions += m_stats.instructions - m_run_start_instructions;
+        stats.run_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - *m_run_start).count();
+    }
+    return stats;
+}
+
+void Machine::reset_stats() {
+    m_stats = {};
+    m_journal_records_at_reset = m_changes.get_pushed_record_count();
+    if (m_run_start) {
+        m_run_start = std::chrono::steady_clock::now();
+        m_run_start_instructions = 0;
+    }
+    if (m_stats_dump) m_next_stats_dump = m_stats_dump_interval;
+}
+
+void Machine::set_stats_dump(std::unique_ptr<std::ostream> stream, uint64_t interval) {
+    if (!stream || interval == 0) {
+        if (m_stats_dump) m_stats_dump->flush();
+        m_stats_dump.reset();
+        m_next_stats_dump = std::numeric_limits<uint64_t>::max();
+        return;
+    }
+
+    m_stats_dump = std::move(stream);
+    m_stats_dump_interval = interval;
+    m_next_stats_dump = m_stats.instructions + interval;
+}
+
+void Machine::dump_stats() {
+    // Flushed so the file can be followed while the program runs
+    *m_stats_dump << get_stats() << std::endl;
+    m_next_stats_dump = m_stats.instructions + m_stats_dump_interval;
+}
+
+std::ostream &operator<<(std::ostream &os, const MachineStats &stats) {
+    os << std::dec << "{\"instructions\": " << stats.instructions << ", \"format_instructions\": [";
+    for (size_t i = 0; i < stats.format_instructions.size(); i++) {
+        os << (i ? ", " : "") << stats.format_instructions[i];
+    }
+    os << "], \"memory_reads\": " << stats.memory_reads << ", \"memory_writes\": " << stats.memory_writes;
+    os << ", \"device_reads\": " << stats.device_reads << ", \"device_writes\": " << stats.device_writes;
+    os << ", \"device_tests\": " << stats.device_tests << ", \"journal_bytes\": " << stats.journal_bytes;
+    os << ", \"run_instructions\": " << stats.run_instructions << ", \"run_seconds\": " << stats.run_seconds << "}";
+    return os;
+}
+
+void Machine::set_trace(std::unique_ptr<TraceRecorder> trace) {
+    m_trace = std::move(trace);
+    m_tracing = m_trace != nullptr;
+}
+
+bool Machine::is_tracing() const {
+    return m_tracing;
+}
+
+void Machine::enable_caches(const CacheConfig &instruction_cache, const CacheConfig &data_cache) {
+    m_icache = std::make_unique<CacheSimulator>(instruction_cache);
+    m_dcache = std::make_unique<CacheSimulator>(data_cache);
+    m_caching = true;
+}
+
+void Machine::disable_caches() {
+    m_caching = false;
+}
+
+bool Machine::is_caching() const {
+    return m_caching;
+}
+
+const CacheSimulator* Machine::get_icache() const {
+    return m_icache.get();
+}
+
+const CacheSimulator* Machine::get_dcache() const {
+    return m_dcache.get();
+}
+
+Machine::Observers Machine::pause_observers() {
+    return {
+        .profiling = std::exchange(m_profiling, false),
+        .tracing = std::exchange(m_tracing, false),
+        .caching = std::exchange(m_caching, false)
+    };
+}
+
+void Machine::resume_observers(const Observers &observers) {
+    m_profiling = observers.profiling;
+    m_tracing = observers.tracing;
+    m_caching = observers.caching;
+}
+
 void Machine::set_execution_breakpoint(Address_t breakpoint_address) {
-    m_execution_breakpoints.insert(breakpoint_address);
+    m_instruction_cache.set_breakpoint(breakpoint_address, true);
+    // Compiled blocks never span a breakpoint
+    m_block_cache.clear();
 }
 
 void Machine::clear_execution_breakpoint(Address_t breakpoint_address) {
-    m_execution_breakpoints.erase(breakpoint_address);
+    m_instruction_cache.set_breakpoint(breakpoint_address, false);
 }
 
 void Machine::clear_execution_breakpoints() {
-    m_execution_breakpoints.clear();
+    m_instruction_cache.clear_breakpoints();
 }
 
 void Machine::run() {
-    while (!pc_is_on_breakpoint() && !in_halt_condition()) {
-        step();
+    run_until(std::numeric_limits<uint64_t>::max(), StopReason::Breakpoint | StopReason::Watchpoint);
+}
+
+StopReason Machine::run_until(uint64_t instruction_limit, StopMask stop_mask) {
+    m_watch_hit.reset();
+    if (m_halted) return StopReason::Halted;
+
+    m_stop_events = 0;
+    m_run_start = std::chrono::steady_clock::now();
+    m_run_start_instructions = m_stats.instructions;
+
+    auto reason = m_engine == ExecutionEngine::BasicBlock
+            ? run_blocks(instruction_limit, stop_mask)
+            : run_instructions(instruction_limit, stop_mask);
+
+    // Stopped on a breakpoint or watchpoint, show everything the program wrote so far
+    flush_devices();
+
+    auto stats = get_stats();
+    m_stats.run_instructions = stats.run_instructions;
+    m_stats.run_seconds = stats.run_seconds;
+    m_run_start.reset();
+    return reason;
+}
+
+StopReason Machine::run_instructions(uint64_t instruction_limit, StopMask stop_mask) {
+    bool stop_on_breakpoint = stop_mask & stop_on(StopReason::Breakpoint);
+
+    while (m_instruction_count < instruction_limit) {
+        auto& instruction = m_instruction_cache.get(m_registers.getPc());
+        if (instruction.breakpoint && stop_on_breakpoint) return StopReason::Breakpoint;
+
+        execute(instruction);
+
+        if (m_stop_events) {
+            if (auto reason = take_stop_event(stop_mask)) return *reason;
+        }
+    }
+
+    return StopReason::Budget;
+}
+
+StopReason Machine::run_blocks(uint64_t instruction_limit, StopMask stop_mask) {
+    bool stop_on_breakpoint = stop_mask & stop_on(StopReason::Breakpoint);
+    BasicBlock* previous = nullptr;
+
+    while (m_instruction_count < instruction_limit) {
+        if (stop_on_breakpoint && pc_is_on_breakpoint()) return StopReason::Breakpoint;
+
+        if (m_code_modified) {
+            m_block_cache.clear();
+            m_code_modified = false;
+            previous = nullptr;
+        }
+
+        auto pc = m_registers.getPc();
+        BasicBlock* block = nullptr;
+
+        if (previous) {
+            for (size_t i = 0; i < previous->successors.size(); i++) {
+                if (previous->successors[i] && previous->successor_addresses[i] == pc) {
+                    block = previous->successors[i];
+                    break;
+                }
+            }
+        }
+
+        if (!block) {
+            block = m_block_cache.find(pc);
+            if (!block && m_block_cache.mark_executed(pc)) {
+                block = &compile_block(pc);
+            }
+
+            // Chain into the first free slot, the second one is replaced once both are taken
+            if (block && previous) {
+                auto slot = previous->successors[0] ? 1 : 0;
+                previous->successor_addresses[slot] = pc;
+                previous->successors[slot] = block;
+            }
+        }
+
+        // Cold code, instructions that can't be compiled and blocks that would run past the limit
+        // run on the threaded handlers up to the end of their block
+        if (!block || block->instructions.empty() || block->instructions.size() > instruction_limit - m_instruction_count) {
+            previous = nullptr;
+            if (auto reason = run_cold_block(instruction_limit, stop_mask)) return *reason;
+            continue;
+        }
+
+        if (m_instruction_count >= m_next_checkpoint) take_checkpoint();
+        if (m_stats.instructions >= m_next_stats_dump) dump_stats();
+
+        execute_block(*block);
+        previous = block;
+
+        if (m_stop_events) {
+            if (auto reason = take_stop_event(stop_mask)) return *reason;
+        }
+    }
+
+    return StopReason::Budget;
+}
+
+// Looks up no blocks, so the next lookup happens where a block can start
+std::optional<StopReason> Machine::run_cold_block(uint64_t instruction_limit, StopMask stop_mask) {
+    bool stop_on_breakpoint = stop_mask & stop_on(StopReason::Breakpoint);
+
+    while (m_instruction_count < instruction_limit) {
+        auto pc = m_registers.getPc();
+        auto& instruction = m_instruction_cache.get(pc);
+        if (instruction.breakpoint && stop_on_breakpoint) return StopReason::Breakpoint;
+
+        execute(instruction);
+
+        if (m_stop_events) {
+            if (auto reason = take_stop_event(stop_mask)) return reason;
+        }
+        if (ends_block(instruction) || m_registers.getPc() != pc + instruction.length) return std::nullopt;
+    }
+
+    return StopReason::Budget;
+}
+
+std::optional<StopReason> Machine::take_stop_event(StopMask stop_mask) {
+    auto events = std::exchange(m_stop_events, 0);
+
+    if (events & stop_on(StopReason::Halted)) return StopReason::Halted;
+    if (events & stop_on(StopReason::Watchpoint)) {
+        if (stop_mask & stop_on(StopReason::Watchpoint)) return StopReason::Watchpoint;
+        m_watch_hit.reset();
+    }
+    if (events & stop_mask & stop_on(StopReason::DeviceWait)) return StopReason::DeviceWait;
+    return std::nullopt;
+}
+
+// Indexed by opcode >> 2
+static constexpr std::array<bool, 64> opcode_table(std::initializer_list<Opcode> opcodes) {
+    std::array<bool, 64> table {};
+    for (auto op : opcodes) table[static_cast<uint8_t>(op) >> 2] = true;
+    return table;
+}
+
+// Devices and unimplemented instructions stay in the interpreter
+static constexpr auto uncompiled_opcodes = [] {
+    using enum Opcode;
+    return opcode_table({SVC, RD, WD, TD, LDF, STF, ADDF, SUBF, MULF, DIVF, COMPF, LPS, STI, SSK});
+}();
+
+static constexpr auto jump_opcodes = [] {
+    using enum Opcode;
+    return opcode_table({J, JEQ, JGT, JLT, JSUB, RSUB});
+}();
+
+bool Machine::is_compilable(const DecodedInstruction &instruction) {
+    return instruction.valid && instruction.format != Format::F1 &&
+           !uncompiled_opcodes[static_cast<uint8_t>(instruction.opcode) >> 2];
+}
+
+// Jumps end a block, so does anything a block can't contain
+bool Machine::ends_block(const DecodedInstruction &instruction) {
+    return !is_compilable(instruction) || jump_opcodes[static_cast<uint8_t>(instruction.opcode) >> 2];
+}
+
+BasicBlock& Machine::compile_block(Address_t address) {
+    BasicBlock block { .start_address = address };
+
+    while (block.instructions.size() < max_block_length && address < Memory::mem_size) {
+        auto& instruction = m_instruction_cache.get(address);
+        if (address != block.start_address && instruction.breakpoint) break;
+        if (!is_compilable(instruction)) break;
+
+        block.instructions.push_back(instruction);
+        address += instruction.length;
+
+        if (ends_block(instruction)) break;
+    }
+
+    block.end_address = address;
+    return m_block_cache.insert(std::move(block));
+}
+
+void Machine::execute_block(const BasicBlock& block) {
+    for (auto& instruction : block.instructions) {
+        auto pc = m_registers.getPc();
+        if (m_profiling) m_profiler->count_execution(pc);
+        if (m_tracing) m_trace->record_instruction(pc, *m_memory, instruction.length);
+        if (m_caching) m_icache->access(pc, instruction.length);
+        add_change_step(ChangeStart{pc, instruction.cycles});
+        add_change_step(m_registers.setPc(pc + instruction.length));
+        m_instruction_count++;
+        m_cycle_count += instruction.cycles;
+        m_stats.instructions++;
+        m_stats.format_instructions[instruction.length - 1]++;
+
+        (this->*threaded_handlers[static_cast<uint8_t>(instruction.opcode) >> 2])(instruction);
+
+        // Self modifying code, the rest of this block may be stale
+        if (m_code_modified || m_stop_events) return;
     }
 }
 
+void Machine::invalidate_code(Address_t address, size_t length) {
+    m_instruction_cache.invalidate(address, length);
+    if (m_block_cache.contains_code(address, length)) m_code_modified = true;
+}
+
 bool Machine::pc_is_on_breakpoint() {
-    return m_execution_breakpoints.contains(m_registers.getPc());
+    return m_instruction_cache.has_breakpoint(m_registers.getPc());
 }
 
-const std::deque<Machine::Change_t>& Machine::get_changes() {
+const ChangeJournal& Machine::get_changes() {
     return m_changes;
 }
+
+void Machine::set_journal_capacity(size_t capacity) {
+    m_changes.set_capacity(capacity);
+}
+
+bool Machine::reverse_step(uint64_t steps) {
+    if (m_instruction_count == 0) return false;
+
+    travel_to(m_instruction_count - std::min(steps, m_instruction_count));
+    return true;
+}
+
+bool Machine::reverse_continue() {
+    if (m_instruction_count == 0) return false;
+
+    auto found = find_last_boundary(m_instruction_count - 1, [&](bool) {
+        return pc_is_on_breakpoint();
+    });
+
+    travel_to(found.value_or(m_checkpoints.front().instruction_count));
+    return found.has_value();
+}
+
+bool Machine::reverse_to_last_change(Address_t address) {
+    auto current = m_instruction_count;
+
+    auto found = find_last_boundary(current, [&, previous = Byte_t {}](bool segment_start) mutable {
+        auto value = m_memory->get_byte(address);
+        bool changed = !segment_start && value != previous;
+        previous = value;
+        return changed;
+    });
+
+    // The boundary after the change, stop in front of the instruction that made it
+    travel_to(found ? *found - 1 : current);
+    return found.has_value();
+}
+
+void Machine::set_checkpoint_interval(uint64_t instructions) {
+    m_checkpoint_interval = instructions;
+
+    if (m_checkpoints.empty()) m_next_checkpoint = 0;
+    else if (instructions == 0) m_next_checkpoint = std::numeric_limits<uint64_t>::max();
+    else m_next_checkpoint = m_checkpoints.back().instruction_count + instructions;
+}
+
+uint64_t Machine::get_checkpoint_interval() const {
+    return m_checkpoint_interval;
+}
+
+size_t Machine::get_checkpoint_count() const {
+    return m_checkpoints.size();
+}
+
+uint64_t Machine::get_instruction_count() const {
+    return m_instruction_count;
+}
+
+uint64_t Machine::get_cycle_count() const {
+    return m_cycle_count;
+}
+
+void Machine::set_cost_model(const CostModel &cost_model) {
+    m_instruction_cache.set_cost_model(cost_model);
+    // Compiled blocks hold copies of the decoded instructions
+    m_block_cache.clear();
+    m_code_modified = false;
+}
+
+const CostModel &Machine::get_cost_model() const {
+    return m_instruction_cache.get_cost_model();
+}
+
+void Machine::take_checkpoint() {
+    m_checkpoints.push_back({
+        .instruction_count = m_instruction_count,
+        .cycle_count = m_cycle_count,
+        .registers = m_registers,
+        .memory = *m_memory,
+        .halted = m_halted,
+        .device_event_index = m_device_event_index
+    });
+
+    // Keeps the history unbounded at the cost of longer re-execution for older checkpoints
+    if (m_checkpoints.size() > max_checkpoints) {
+        size_t kept = 0;
+        for (size_t i = 0; i < m_checkpoints.size(); i += 2) {
+            m_checkpoints[kept++] = std::move(m_checkpoints[i]);
+        }
+        m_checkpoints.erase(m_checkpoints.begin() + kept, m_checkpoints.end());
+        m_checkpoint_interval *= 2;
+    }
+
+    // Time travel can't go further back than the checkpoints, the events before them are of no use
+    if (m_device_events.size() > max_device_events && m_checkpoints.size() > 1) {
+        m_checkpoints.erase(m_checkpoints.begin(), m_checkpoints.begin() + static_cast<std::ptrdiff_t>(m_checkpoints.size() / 2));
+        trim_device_log();
+    }
+
+    set_checkpoint_interval(m_checkpoint_interval);
+}
+
+void Machine::trim_device_log() {
+    auto dropped = m_checkpoints.front().device_event_index;
+    if (dropped == 0) return;
+
+    // Undoing past the oldest checkpoint would leave the log behind
+    m_changes.clear();
+
+    m_device_events.erase(m_device_events.begin(), m_device_events.begin() + static_cast<std::ptrdiff_t>(dropped));
+    m_device_event_index -= dropped;
+    m_device_events_performed -= dropped;
+    for (auto& checkpoint : m_checkpoints) {
+        checkpoint.device_event_index -= dropped;
+    }
+}
+
+void Machine::restore_checkpoint(const Checkpoint& checkpoint) {
+    m_registers = checkpoint.registers;
+    *m_memory = checkpoint.memory;
+    m_halted = checkpoint.halted;
+    m_instruction_count = checkpoint.instruction_count;
+    m_cycle_count = checkpoint.cycle_count;
+    m_device_event_index = checkpoint.device_event_index;
+
+    // Undo history and decoded code belong to the state we left
+    m_changes.clear();
+    m_instruction_cache.clear();
+    m_block_cache.clear();
+    m_code_modified = false;
+}
+
+void Machine::travel_to(uint64_t instruction_count) {
+    // The journal is cheaper than re-executing when it reaches back far enough
+    while (m_instruction_count > instruction_count && can_undo()) {
+        undo();
+    }
+
+    if (m_instruction_count > instruction_count) {
+        instruction_count = std::max(instruction_count, m_checkpoints.front().instruction_count);
+        auto checkpoint = std::upper_bound(m_checkpoints.begin(), m_checkpoints.end(), instruction_count,
+            [](uint64_t count, const Checkpoint& checkpoint) { return count < checkpoint.instruction_count; });
+        assert(checkpoint != m_checkpoints.begin());
+        restore_checkpoint(*std::prev(checkpoint));
+    }
+
+    auto observers = pause_observers();
+    while (m_instruction_count < instruction_count && !m_halted) {
+        execute();
+    }
+    resume_observers(observers);
+
+    // Accesses made while re-executing are not reported
+    m_watch_hit.reset();
+}
+
+// Replays checkpoint intervals newest first and returns the latest instruction boundary up to last
+// where matches returned true. matches is called at every boundary, segment_start is set on the first one of an interval.
+template<class Matches>
+std::optional<uint64_t> Machine::find_last_boundary(uint64_t last, Matches matches) {
+    auto record_changes = std::exchange(m_record_changes, false);
+    auto observers = pause_observers();
+
+    std::optional<uint64_t> found {};
+    auto segment_end = last;
+    auto checkpoint_index = std::upper_bound(m_checkpoints.begin(), m_checkpoints.end(), last,
+        [](uint64_t count, const Checkpoint& checkpoint) { return count < checkpoint.instruction_count; })
+        - m_checkpoints.begin();
+
+    while (!found && checkpoint_index-- > 0) {
+        auto& checkpoint = m_checkpoints[checkpoint_index];
+        restore_checkpoint(checkpoint);
+
+        for (bool segment_start = true; ; segment_start = false) {
+            if (matches(segment_start)) found = m_instruction_count;
+            if (m_instruction_count >= segment_end || m_halted) break;
+            execute();
+        }
+
+        segment_end = checkpoint.instruction_count;
+    }
+
+    m_record_changes = record_changes;
+    resume_observers(observers);
+    return found;
+}
+
+// Device access goes through the event log, instructions that are executed again replay the logged value
+template<class Access>
+Byte_t Machine::device_event(DeviceAccess kind, Byte_t device_id, Access access) {
+    if (m_device_event_index < m_device_events.size()) {
+        auto& event = m_device_events[m_device_event_index];
+
+        if (event.instruction_count == m_instruction_count && event.device_id == device_id && event.access == kind) {
+            m_device_event_index++;
+            if (kind == DeviceAccess::Write && m_device_event_index > m_device_events_performed) {
+                access();
+                m_device_events_performed = m_device_event_index;
+            }
+            return event.value;
+        }
+
+        // Execution diverged from the log, the rest of it no longer applies
+        m_device_events.erase(m_device_events.begin() + static_cast<std::ptrdiff_t>(m_device_event_index), m_device_events.end());
+    }
+
+    auto value = static_cast<Byte_t>(access());
+    if (!m_device_logging) return value;
+
+    m_device_events.push_back({
+        .instruction_count = m_instruction_count,
+        .device_id = device_id,
+        .access = kind,
+        .value = value
+    });
+    m_device_event_index++;
+    m_device_events_performed = m_device_event_index;
+    return value;
+}
+
+void Machine::set_device_logging(bool enabled) {
+    if (!enabled) {
+        m_device_events.clear();
+        m_device_event_index = 0;
+        m_device_events_performed = 0;
+        for (auto& checkpoint : m_checkpoints) {
+            checkpoint.device_event_index = 0;
+        }
+    }
+    m_device_logging = enabled;
+}
+
+bool Machine::is_device_logging() const {
+    return m_device_logging;
+}
+
+size_t Machine::get_device_event_count() const {
+    return m_device_events.size();
+}
+
+void Machine::save_device_log(std::ostream &stream) const {
+    device_log::write(stream, m_device_events);
+}
+
+bool Machine::replay_device_log(std::istream &stream) {
+    if (m_instruction_count != 0) return false;
+
+    auto events = device_log::read(stream);
+    if (!events) return false;
+
+    m_device_events = std::move(*events);
+    m_device_event_index = 0;
+    m_device_events_performed = 0;
+    return true;
+}
@@ -5,47 +5,248 @@
 #ifndef ASS2_MACHINE_H
 #define ASS2_MACHINE_H
 
+#include <chrono>
+#include <functional>
+#include <limits>
 #include <memory>
+#include <optional>
 #include <variant>
-#include <deque>
-#include <set>
+#include <vector>
 #include "Memory.h"
 #include "Registers.h"
 #include "../common/Mnemonics.h"
 #include "../common/Flags.h"
 #include "Device.h"
+#include "InstructionCache.h"
+#include "BlockCache.h"
+#include "ChangeJournal.h"
+#include "DeviceLog.h"
+#include "Profiler.h"
+#include "CacheSimulator.h"
+#include "Trace.h"
+
+enum class ExecutionEngine {
+    // Dispatches through the per format switch statements
+    Interpreter,
+    // Dispatches each decoded instruction straight to its opcode handler
+    Threaded,
+    // Like Threaded, but run_until() dispatches hot basic blocks as a whole, skipping the per instruction
+    // lookups and checks. The blocks still run on the threaded handlers, no code is generated
+    BasicBlock
+};
+
+enum class WatchKind {
+    Read,
+    Write,
+    // Writes that change the stored value
+    Change
+};
+
+struct Watchpoint {
+    Address_t start_address;
+    size_t length;
+    WatchKind kind;
+};
+
+struct WatchHit {
+    WatchKind kind;
+    Address_t address;
+    uint8_t length;
+    uint32_t previous_value;
+    // Same as previous_value for reads
+    uint32_t new_value;
+};
+
+// Why run_until() returned, each reason is also its bit in a stop mask
+enum class StopReason : uint8_t {
+    Halted = 1 << 0,
+    Breakpoint = 1 << 1,
+    Watchpoint = 1 << 2,
+    // The instruction limit was reached
+    Budget = 1 << 3,
+    // TD found the device not ready
+    DeviceWait = 1 << 4
+};
+
+using StopMask = uint8_t;
+
+constexpr StopMask stop_on(StopReason reason) {
+    return static_cast<StopMask>(reason);
+}
+
+constexpr StopMask operator|(StopReason a, StopReason b) {
+    return stop_on(a) | stop_on(b);
+}
+
+constexpr StopMask operator|(StopMask mask, StopReason reason) {
+    return mask | stop_on(reason);
+}
+
+// Counters include instructions executed again by time travel
+struct MachineStats {
+    uint64_t instructions {};
+    // Indexed by instruction length, format 1 to 4
+    std::array<uint64_t, 4> format_instructions {};
+    uint64_t memory_reads {};
+    uint64_t memory_writes {};
+    uint64_t device_reads {};
+    uint64_t device_writes {};
+    uint64_t device_tests {};
+    uint64_t journal_bytes {};
+    // Instructions executed inside run_until() and the wall time it took
+    uint64_t run_instructions {};
+    double run_seconds {};
+
+    // One line JSON object
+    friend std::ostream &operator<<(std::ostream &os, const MachineStats &stats);
+};
 
 class Machine {
 public:
-    Machine(Address_t start_address, std::shared_ptr<Memory> memory);
+    Machine(Address_t start_address, std::shared_ptr<Memory> memory,
+            ExecutionEngine engine = ExecutionEngine::Interpreter);
+    // Continues from the given register state
+    Machine(const Registers& registers, std::shared_ptr<Memory> memory,
+            ExecutionEngine engine = ExecutionEngine::Interpreter);
+
+    // Independent machine continuing from the current state. Memory pages are shared copy on write,
+    // devices are cloned and the undo history, checkpoints and breakpoints are kept.
+    // Device input the parent logged past the current instruction is dropped, the fork reads live input.
+    // Open file devices continue from memory and the fork's writes to them stay in memory, console output is shared.
+    // Devices the fork opens later come from the same factory, and so from the same files.
+    [[nodiscard]] std::unique_ptr<Machine> fork();
 
     // Machine control
     void step();
+    // Runs until halted or stopped by a breakpoint or watchpoint
     void run();
+    // Runs until the instruction count reaches instruction_limit or a reason in stop_mask comes up.
+    // Halting and the limit always stop, breakpoints are skipped unless they are in the mask.
+    StopReason run_until(uint64_t instruction_limit, StopMask stop_mask);
     bool can_undo();
     void undo();
+    // Turning recording off drops the undo history and skips journaling until it is turned back on
+    void set_change_recording(bool enabled);
+    [[nodiscard]] bool is_recording_changes() const;
+
+    // Time travel, reverse execution restores the closest checkpoint and executes forward from it.
+    // Device traffic is replayed from the device event log, so re-execution is deterministic.
+    bool reverse_step(uint64_t steps = 1);
+    // Travels back to the last stop on a breakpoint, or to the oldest checkpoint when there is none
+    bool reverse_continue();
+    // Travels back to the instruction that last changed the byte at address, stays put when there is none
+    bool reverse_to_last_change(Address_t address);
+    // Instructions between checkpoints, 0 stops taking new ones. The program start is kept
+    // until the device log outgrows max_device_events.
+    void set_checkpoint_interval(uint64_t instructions);
+    [[nodiscard]] uint64_t get_checkpoint_interval() const;
+    [[nodiscard]] size_t get_checkpoint_count() const;
+    [[nodiscard]] uint64_t get_instruction_count() const;
+    // Simulated cycles of the instructions executed so far, follows the instruction count through time travel
+    [[nodiscard]] uint64_t get_cycle_count() const;
+    // Set before running. Undo takes back the cycles an instruction was charged, re-execution
+    // during time travel counts with the current model.
+    void set_cost_model(const CostModel& cost_model);
+    [[nodiscard]] const CostModel& get_cost_model() const;
+
+    // Stops step() and run() after the instruction that accesses the watched range
+    void set_watchpoint(Address_t address, size_t length, WatchKind kind);
+    // Clears all watchpoints starting at address
+    void clear_watchpoint(Address_t address);
+    void clear_watchpoints();
+    // Hit from the last step() or run_until(), if any
+    [[nodiscard]] const std::optional<WatchHit>& get_watch_hit() const;
 
     void set_execution_breakpoint(Address_t breakpoint_address);
     void clear_execution_breakpoint(Address_t breakpoint_address);
     void clear_execution_breakpoints();
 
+    // Counts executions, conditional jump outcomes and memory accesses per address.
+    // Enabling starts a fresh profile, disabling keeps the last one. Re-execution during time travel is not counted.
+    void set_profiling(bool enabled);
+    [[nodiscard]] bool is_profiling() const;
+    // nullptr until profiling was enabled
+    [[nodiscard]] const Profiler* get_profile() const;
+
+    // Streams every executed instruction with the changes it makes to the recorder, nullptr stops tracing
+    // and writes out the rest of the trace. Re-execution during time travel and undo are not recorded.
+    void set_trace(std::unique_ptr<TraceRecorder> trace);
+    [[nodiscard]] bool is_tracing() const;
+
+    // Simulates separate instruction and data caches in front of memory. Fetches go through the instruction
+    // cache, operand and indirect address accesses through the data cache. Enabling starts with empty caches,
+    // disabling keeps the last counts. Re-execution during time travel is not counted.
+    void enable_caches(const CacheConfig& instruction_cache, const CacheConfig& data_cache);
+    void disable_caches();
+    [[nodiscard]] bool is_caching() const;
+    // nullptr until caches were enabled
+    [[nodiscard]] const CacheSimulator* get_icache() const;
+    [[nodiscard]] const CacheSimulator* get_dcache() const;
+
+    // Device events are logged so time travel and save_device_log see the same device traffic.
+    // Turning logging off drops the log, devices are then read live when execution is repeated.
+    // A replayed log is still followed with logging off, the events after it are not kept.
+    void set_device_logging(bool enabled);
+    [[nodiscard]] bool is_device_logging() const;
+    [[nodiscard]] size_t get_device_event_count() const;
+    // Saves the logged device events, reads and tests along with writes. Events older than
+    // the oldest checkpoint are dropped once the log outgrows max_device_events.
+    void save_device_log(std::ostream& stream) const;
+    // Replays a saved device log from the program start. Reads and tests return the logged values
+    // without touching the devices, writes still go out. Once the log runs out or execution takes
+    // a different path, the devices are used again. False after the first instruction or for an invalid log.
+    bool replay_device_log(std::istream& stream);
+
+    [[nodiscard]] MachineStats get_stats() const;
+    void reset_stats();
+    // Writes the stats as a line to stream every interval instructions, nullptr or 0 stops
+    void set_stats_dump(std::unique_ptr<std::ostream> stream, uint64_t interval);
+
+    // Devices buffer their output until they are flushed, which also happens when the program halts
+    void flush_devices();
+    // Replaces the device used by RD, WD and TD with the given id
+    void set_device(Byte_t id, std::unique_ptr<Device> device);
+    // Creates devices on their first RD or WD, for_write is set when a WD comes first.
+    // Returning nullptr leaves the device absent, RD then reads 0 and WD is dropped.
+    using DeviceFactory = std::function<std::unique_ptr<Device>(Byte_t id, bool for_write)>;
+    // The default factory opens NN.dev files
+    void set_device_factory(DeviceFactory factory);
+
     [[nodiscard]] const Registers &get_registers() const;
+    // Recorded in the undo history like a change made by an instruction
+    void set_register(Register reg, Register_t new_value);
     [[nodiscard]] std::shared_ptr<Memory> get_memory() const;
-    struct ChangeStart { Address_t pc; };
-    using Change_t = std::variant<ChangeStart, MemoryChange, RegisterChange>;
-    [[nodiscard]] const std::deque<Change_t>& get_changes();
+    using ChangeStart = ::ChangeStart;
+    using Change_t = ::Change_t;
+    [[nodiscard]] const ChangeJournal& get_changes();
+    // Capacity in packed records, drops the current history
+    void set_journal_capacity(size_t capacity);
     [[nodiscard]] bool in_halt_condition() const;
 
 private:
-    [[nodiscard]] uint8_t fetch();
-
     void execute();
+    void execute(const DecodedInstruction& instruction);
 
-    [[nodiscard]] bool execute_format1(uint8_t b0);
-    [[nodiscard]] bool execute_format2(uint8_t b0, uint8_t b1);
-    [[nodiscard]] bool execute_format3_4(uint8_t b0, uint8_t b1, uint8_t b2);
+    void execute_format1(const DecodedInstruction& instruction);
+    void execute_format2(const DecodedInstruction& instruction);
+    void execute_format3_4(const DecodedInstruction& instruction);
+    void execute_invalid(const DecodedInstruction& instruction);
 
-    void set_register(Register reg, Register_t new_value);
+    template<Opcode op>
+    void execute_instruction(const DecodedInstruction& instruction);
+
+    StopReason run_instructions(uint64_t instruction_limit, StopMask stop_mask);
+    StopReason run_blocks(uint64_t instruction_limit, StopMask stop_mask);
+    [[nodiscard]] std::optional<StopReason> run_cold_block(uint64_t instruction_limit, StopMask stop_mask);
+    [[nodiscard]] std::optional<StopReason> take_stop_event(StopMask stop_mask);
+    BasicBlock& compile_block(Address_t address);
+    [[nodiscard]] static bool is_compilable(const DecodedInstruction& instruction);
+    [[nodiscard]] static bool ends_block(const DecodedInstruction& instruction);
+    void execute_block(const BasicBlock& block);
+    void invalidate_code(Address_t address, size_t length);
+
+    using InstructionHandler = void (Machine::*)(const DecodedInstruction&);
+    static const std::array<InstructionHandler, 64> threaded_handlers;
 
     [[nodiscard]] Address_t resolve_address(const Flags& flags, Address_t address);
 
@@ -54,23 +255,111 @@ private:
     [[nodiscard]] Word_t get_word(const Flags& flags, Address_t address);
     [[nodiscard]] Byte_t get_byte(const Flags& flags, Address_t address);
 
-    void add_change_step(Change_t change);
+    void dump_stats();
+
+    void conditional_jump(const DecodedInstruction& instruction, Address_t address, bool taken);
+
+    [[nodiscard]] bool is_watched(Address_t address, size_t length) const;
+    void check_watchpoints(WatchKind access, Address_t address, uint8_t length,
+                           uint32_t previous_value, uint32_t new_value);
+
+    template<class Change>
+    void add_change_step(const Change& change);
 
     bool pc_is_on_breakpoint();
 
+    struct Checkpoint {
+        uint64_t instruction_count;
+        uint64_t cycle_count;
+        Registers registers;
+        Memory memory;
+        bool halted;
+        size_t device_event_index;
+    };
+
+    void take_checkpoint();
+    // Drops the device events the checkpoints no longer reach back to
+    void trim_device_log();
+    void restore_checkpoint(const Checkpoint& checkpoint);
+    void travel_to(uint64_t instruction_count);
+    // Profiling, tracing and cache simulation are off while time travel executes instructions again
+    struct Observers {
+        bool profiling;
+        bool tracing;
+        bool caching;
+    };
+    Observers pause_observers();
+    void resume_observers(const Observers& observers);
+    template<class Matches>
+    std::optional<uint64_t> find_last_boundary(uint64_t last, Matches matches);
+    template<class Access>
+    Byte_t device_event(DeviceAccess kind, Byte_t device_id, Access access);
+
     static void not_implemented(Opcode opcode);
 private:
     std::shared_ptr<Memory> m_memory;
     Registers m_registers {};
+    // Also holds the execution breakpoints, as a flag on each decoded instruction
+    InstructionCache m_instruction_cache;
+    ExecutionEngine m_engine;
+
+    static constexpr size_t max_block_length = 64;
+    BlockCache m_block_cache {};
+    bool m_code_modified { false };
+
+    [[nodiscard]] Device* get_device(Byte_t id, bool for_write);
+
+    std::array<std::unique_ptr<Device>, 256> m_devices {};
+    DeviceFactory m_device_factory;
+
+    ChangeJournal m_changes {};
+    bool m_record_changes { true };
+
+    std::vector<Watchpoint> m_watchpoints {};
+    // Accesses to pages without a watchpoint skip the watchpoint list
+    std::vector<bool> m_watched_pages = std::vector<bool>(Memory::page_count);
+    std::optional<WatchHit> m_watch_hit {};
+
+    std::unique_ptr<Profiler> m_profiler {};
+    bool m_profiling { false };
+
+    MachineStats m_stats {};
+    // The journal counts its own records
+    uint64_t m_journal_records_at_reset {};
+    std::unique_ptr<std::ostream> m_stats_dump {};
+    uint64_t m_stats_dump_interval {};
+    uint64_t m_next_stats_dump { std::numeric_limits<uint64_t>::max() };
+    // Set while inside run_until(), so stats taken meanwhile include the run so far
+    std::optional<std::chrono::steady_clock::time_point> m_run_start {};
+    uint64_t m_run_start_instructions {};
+
+    std::unique_ptr<TraceRecorder> m_trace {};
+    bool m_tracing { false };
 
-    std::map<Byte_t, std::unique_ptr<Device>> m_devices;
+    std::unique_ptr<CacheSimulator> m_icache {};
+    std::unique_ptr<CacheSimulator> m_dcache {};
+    bool m_caching { false };
 
-    static constexpr size_t max_changes = 200;
-    std::deque<Change_t> m_changes {};
+    static constexpr uint64_t default_checkpoint_interval = 1 << 16;
+    // Every other checkpoint is dropped and the interval doubled once there are more
+    static constexpr size_t max_checkpoints = 256;
+    uint64_t m_instruction_count {};
+    uint64_t m_cycle_count {};
+    uint64_t m_checkpoint_interval { default_checkpoint_interval };
+    uint64_t m_next_checkpoint {};
+    std::vector<Checkpoint> m_checkpoints {};
 
-    std::set<Address_t> m_execution_breakpoints {};
+    // Past this the older half of the checkpoints is dropped along with the events before them
+    static constexpr size_t max_device_events = 1 << 20;
+    std::vector<DeviceEvent> m_device_events {};
+    bool m_device_logging { true };
+    size_t m_device_event_index {};
+    // Events before this one reached the device, later writes of a replayed log still have to
+    size_t m_device_events_performed {};
 
     bool m_halted { false };
+    // Stop reasons raised by the last instructions, the run loops check nothing else per instruction
+    StopMask m_stop_events {};
 };
 
 
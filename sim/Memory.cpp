@@ -2,23 +2,34 @@
 // Created by Lenart on 12/11/2022.
 //
 
+#include <algorithm>
 #include <cassert>
 #include <iomanip>
 #include "Memory.h"
 
-Memory::Memory()
-    : m_alloc(new decltype(m_alloc)::element_type {})
-{
-//    std::fill(m_alloc->begin(), m_alloc->end(), 0);
+Memory::Memory() {
+    m_pages.fill(zero_page());
 }
 
 Memory::Memory(Memory &&other) noexcept
-    : m_alloc(std::move(other.m_alloc))
+    : m_pages(std::move(other.m_pages))
 {}
 
+Memory::Page &Memory::writable_page(Address_t addr) {
+    auto& page = m_pages[addr >> page_bits];
+    // Shared with a snapshot or still the zero page
+    if (page.use_count() > 1) page = std::make_shared<Page>(*page);
+    return *page;
+}
+
+const std::shared_ptr<Memory::Page> &Memory::zero_page() {
+    static const auto page = std::make_shared<Page>();
+    return page;
+}
+
 Byte_t Memory::get_byte(Address_t addr) const {
     if (addr >= mem_size) return 0;
-    return (*m_alloc)[addr];
+    return (*m_pages[addr >> page_bits])[addr & (page_size - 1)];
 }
 
 MemoryChange Memory::set_byte(Address_t addr, Byte_t b) {
@@ -29,13 +40,20 @@ MemoryChange Memory::set_byte(Address_t addr, Byte_t b) {
             .previous_value = get_byte(addr),
             .new_value = b
     };
-    (*m_alloc)[addr] = b;
+    writable_page(addr)[addr & (page_size - 1)] = b;
     return change;
 }
 
 Word_t Memory::get_word(Address_t addr) const {
     if (addr + 2 >= mem_size) return 0;
-    auto word = (*m_alloc)[addr] << 16 | (*m_alloc)[addr + 1] << 8 | (*m_alloc)[addr + 2];
+    Word_t word;
+    auto offset = addr & (page_size - 1);
+    if (offset + 2 < page_size) {
+        auto& page = *m_pages[addr >> page_bits];
+        word = page[offset] << 16 | page[offset + 1] << 8 | page[offset + 2];
+    } else {
+        word = get_byte(addr) << 16 | get_byte(addr + 1) << 8 | get_byte(addr + 2);
+    }
     if (word & 0x800000) word |= 0xff000000; // NOLINT(cppcoreguidelines-narrowing-conversions)
     else word &= ~0xff000000; // NOLINT(cppcoreguidelines-narrowing-conversions)
     return word;
@@ -49,9 +67,17 @@ MemoryChange Memory::set_word(Address_t addr, Word_t b) {
             .previous_value = get_word(addr),
             .new_value = b
     };
-    (*m_alloc)[addr] = (b & 0xff0000) >> 16;
-    (*m_alloc)[addr + 1] = (b & 0xff00) >> 8;
-    (*m_alloc)[addr + 2] = b & 0xff;
+    auto offset = addr & (page_size - 1);
+    if (offset + 2 < page_size) {
+        auto& page = writable_page(addr);
+        page[offset] = (b & 0xff0000) >> 16;
+        page[offset + 1] = (b & 0xff00) >> 8;
+        page[offset + 2] = b & 0xff;
+    } else {
+        writable_page(addr)[offset] = (b & 0xff0000) >> 16;
+        writable_page(addr + 1)[(addr + 1) & (page_size - 1)] = (b & 0xff00) >> 8;
+        writable_page(addr + 2)[(addr + 2) & (page_size - 1)] = b & 0xff;
+    }
     return change;
 }
 
@@ -82,12 +108,16 @@ void Memory::undo(MemoryChange change) {
 }
 
 
+size_t Memory::get_resident_page_count() const {
+    return std::count_if(m_pages.begin(), m_pages.end(), [](auto& page) { return page != zero_page(); });
+}
+
 std::ostream &operator<<(std::ostream &os, const MemoryChange &change) {
     os << "start_address: 0x";
     os << std::setfill('0') << std::setw(6) << std::hex << change.start_address;
     os << " changed_bytes_length: " << std::dec << (int)change.changed_bytes_length << " previous_value: 0x";
     os << std::setfill('0') << std::setw(6) << std::hex << (change.previous_value & 0xffffff);
     os << " new_value: 0x";
-    os << std::setfill('0') << std::setw(6) << std::hex << (change.previous_value & 0xffffff);
+    os << std::setfill('0') << std::setw(6) << std::hex << (change.new_value & 0xffffff);
     return os;
 }
@@ -30,10 +30,15 @@ struct MemoryChange {
     }
 };
 
+// Memory is split into pages shared between copies, a page is copied on its first write.
+// Copying a Memory is cheap, which makes it usable as a snapshot.
+// Untouched pages all share one zero page, so only pages that were written to take up memory.
 class Memory final {
 public:
     Memory();
+    Memory(const Memory& other) = default;
     Memory(Memory&& other) noexcept;
+    Memory& operator=(const Memory& other) = default;
     ~Memory() = default;
 public:
     [[nodiscard]] Byte_t get_byte(Address_t addr) const;
@@ -47,9 +52,20 @@ public:
 
     void undo(MemoryChange change);
 
+    // Pages that were written to and are no longer the shared zero page
+    [[nodiscard]] size_t get_resident_page_count() const;
+
     static constexpr int mem_size = 1<<20;
+    static constexpr int page_bits = 12;
+    static constexpr int page_size = 1 << page_bits;
+    static constexpr int page_count = mem_size / page_size;
 private:
-    std::unique_ptr<std::array<uint8_t, mem_size>> m_alloc {};
+    using Page = std::array<uint8_t, page_size>;
+
+    [[nodiscard]] Page& writable_page(Address_t addr);
+    static const std::shared_ptr<Page>& zero_page();
+
+    std::array<std::shared_ptr<Page>, page_count> m_pages {};
 };
 
 #endif //ASS2_MEMORY_H
@@ -0,0 +1,201 @@
+//
+// Created by Lenart on 17/10/2026.
+//
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include "Profiler.h"
+
+Profiler::Profiler(Address_t entry_address)
+    : m_call_nodes { CallNode { .function = entry_address, .parent = 0 } }
+    , m_call_stack { CallFrame { .node = 0, .return_address = Memory::mem_size } }
+{}
+
+void Profiler::count_execution(Address_t address) {
+    m_executions[address]++;
+    m_total_executions++;
+    m_call_nodes[m_call_stack.back().node].exclusive++;
+}
+
+void Profiler::count_branch(Address_t address, bool taken) {
+    auto& branch = m_branches[address];
+    if (taken) branch.taken++;
+    else branch.not_taken++;
+}
+
+void Profiler::count_call(Address_t target_address, Address_t return_address) {
+    if (m_call_stack.size() >= max_call_depth) return;
+
+    auto caller = m_call_stack.back().node;
+    auto [child, inserted] = m_call_nodes[caller].children.try_emplace(target_address, m_call_nodes.size());
+    if (inserted) m_call_nodes.push_back({ .function = target_address, .parent = caller });
+
+    auto node = child->second;
+    m_call_nodes[node].calls++;
+    m_call_stack.push_back({ .node = node, .return_address = return_address });
+}
+
+void Profiler::count_return(Address_t target_address) {
+    // The root frame is never left, returns past it leave the stack as is
+    for (auto frame = m_call_stack.size(); frame-- > 1;) {
+        if (m_call_stack[frame].return_address == target_address) {
+            m_call_stack.resize(frame);
+            return;
+        }
+    }
+}
+
+void Profiler::count_jump(Address_t target_address) {
+    if (m_call_stack.size() > 1 && m_call_stack.back().return_address == target_address) {
+        m_call_stack.pop_back();
+    }
+}
+
+void Profiler::count_read(Address_t address) {
+    if (address < Memory::mem_size) m_reads[address]++;
+}
+
+void Profiler::count_write(Address_t address) {
+    if (address < Memory::mem_size) m_writes[address]++;
+}
+
+uint64_t Profiler::get_execution_count(Address_t address) const {
+    return m_executions[address];
+}
+
+uint64_t Profiler::get_total_execution_count() const {
+    return m_total_executions;
+}
+
+BranchCount Profiler::get_branch_count(Address_t address) const {
+    auto it = m_branches.find(address);
+    return it == m_branches.end() ? BranchCount {} : it->second;
+}
+
+uint64_t Profiler::get_read_count(Address_t address) const {
+    return m_reads[address];
+}
+
+uint64_t Profiler::get_write_count(Address_t address) const {
+    return m_writes[address];
+}
+
+void Profiler::report(std::ostream &os, Disassembler &disassembler, size_t limit) const {
+    auto hex = [&](Address_t address) -> std::ostream& {
+        return os << "[0x" << std::setfill('0') << std::setw(6) << std::hex << address << "]" << std::setfill(' ') << std::dec;
+    };
+
+    os << std::setfill(' ') << std::dec << "Instructions executed: " << m_total_executions << std::endl;
+    for (auto address : hottest(limit, [&](Address_t a) { return m_executions[a]; })) {
+        auto count = m_executions[address];
+        auto percent = 100.0 * static_cast<double>(count) / static_cast<double>(m_total_executions);
+
+        // Formatted apart so the fixed precision does not stick to os
+        auto share = std::ostringstream {};
+        share << std::fixed << std::setprecision(2) << std::setw(6) << percent;
+        os << std::setw(12) << count << " " << share.str() << "% ";
+        hex(address) << ": " << disassembler.dissasemble_at(address);
+
+        auto branch = m_branches.find(address);
+        if (branch != m_branches.end()) {
+            os << " (taken " << branch->second.taken << ", not taken " << branch->second.not_taken << ")";
+        }
+        os << std::endl;
+    }
+
+    os << "Memory accesses (reads, writes):" << std::endl;
+    for (auto address : hottest(limit, [&](Address_t a) { return m_reads[a] + m_writes[a]; })) {
+        os << std::setw(12) << m_reads[address] << " " << std::setw(12) << m_writes[address] << " ";
+        hex(address) << std::endl;
+    }
+}
+
+std::vector<FunctionCount> Profiler::get_function_counts() const {
+    auto subtree = inclusive_counts();
+    std::unordered_map<Address_t, FunctionCount> functions {};
+
+    for (size_t node = 0; node < m_call_nodes.size(); node++) {
+        auto& call_node = m_call_nodes[node];
+        auto& function = functions.try_emplace(call_node.function, FunctionCount { .address = call_node.function }).first->second;
+        function.exclusive += call_node.exclusive;
+        function.calls += call_node.calls;
+
+        // Recursive calls are already part of the outermost call's subtree
+        bool recursive = false;
+        for (auto ancestor = node; ancestor != 0 && !recursive;) {
+            ancestor = m_call_nodes[ancestor].parent;
+            recursive = m_call_nodes[ancestor].function == call_node.function;
+        }
+        if (!recursive) function.inclusive += subtree[node];
+    }
+
+    std::vector<FunctionCount> counts {};
+    for (auto& [address, function] : functions) counts.push_back(function);
+    std::sort(counts.begin(), counts.end(), [](const FunctionCount& a, const FunctionCount& b) {
+        return a.inclusive != b.inclusive ? a.inclusive > b.inclusive : a.address < b.address;
+    });
+    return counts;
+}
+
+size_t Profiler::get_call_depth() const {
+    return m_call_stack.size() - 1;
+}
+
+void Profiler::report_functions(std::ostream &os, Disassembler &disassembler, size_t limit) const {
+    auto functions = get_function_counts();
+
+    os << std::setfill(' ') << std::dec << "Subroutines (inclusive, exclusive, calls):" << std::endl;
+    for (size_t i = 0; i < functions.size() && i < limit; i++) {
+        auto& function = functions[i];
+        os << std::setw(12) << function.inclusive << " " << std::setw(12) << function.exclusive << " ";
+        os << std::setw(8) << function.calls << " [0x" << std::setfill('0') << std::setw(6) << std::hex;
+        os << function.address << "]" << std::setfill(' ') << std::dec << ": " << disassembler.dissasemble_at(function.address) << std::endl;
+    }
+}
+
+void Profiler::write_collapsed_stacks(std::ostream &os) const {
+    std::vector<Address_t> path {};
+
+    for (size_t node = 0; node < m_call_nodes.size(); node++) {
+        if (m_call_nodes[node].exclusive == 0) continue;
+
+        path.clear();
+        for (auto frame = node; ; frame = m_call_nodes[frame].parent) {
+            path.push_back(m_call_nodes[frame].function);
+            if (frame == 0) break;
+        }
+
+        for (auto function = path.rbegin(); function != path.rend(); function++) {
+            if (function != path.rbegin()) os << ";";
+            os << "0x" << std::setfill('0') << std::setw(6) << std::hex << *function;
+        }
+        os << " " << std::dec << m_call_nodes[node].exclusive << "\n";
+    }
+}
+
+std::vector<uint64_t> Profiler::inclusive_counts() const {
+    std::vector<uint64_t> subtree(m_call_nodes.size());
+
+    // Children are always created after their parent
+    for (auto node = m_call_nodes.size(); node-- > 0;) {
+        subtree[node] += m_call_nodes[node].exclusive;
+        if (node != 0) subtree[m_call_nodes[node].parent] += subtree[node];
+    }
+    return subtree;
+}
+
+std::vector<Address_t> Profiler::hottest(size_t limit, const auto& count) {
+    std::vector<Address_t> addresses {};
+    for (Address_t address = 0; address < Memory::mem_size; address++) {
+        if (count(address)) addresses.push_back(address);
+    }
+
+    auto middle = addresses.begin() + static_cast<std::ptrdiff_t>(std::min(limit, addresses.size()));
+    std::partial_sort(addresses.begin(), middle, addresses.end(), [&](Address_t a, Address_t b) {
+        auto count_a = count(a), count_b = count(b);
+        return count_a != count_b ? count_a > count_b : a < b;
+    });
+    addresses.erase(middle, addresses.end());
+    return addresses;
+}
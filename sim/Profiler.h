@@ -0,0 +1,95 @@
+//
+// Created by Lenart on 17/10/2026.
+//
+
+#ifndef ASS2_PROFILER_H
+#define ASS2_PROFILER_H
+
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+#include "Memory.h"
+#include "Disassembler.h"
+
+struct BranchCount {
+    uint64_t taken {};
+    uint64_t not_taken {};
+};
+
+struct FunctionCount {
+    Address_t address;
+    // Including the subroutines it calls, recursive calls are counted once
+    uint64_t inclusive {};
+    uint64_t exclusive {};
+    uint64_t calls {};
+};
+
+// Per address execution and memory access counters, indexed directly by address.
+// Also follows JSUB and RSUB on a shadow call stack and attributes each execution to its call path.
+class Profiler {
+public:
+    // The entry address is the root of the call graph
+    explicit Profiler(Address_t entry_address);
+
+    void count_execution(Address_t address);
+    void count_branch(Address_t address, bool taken);
+    void count_call(Address_t target_address, Address_t return_address);
+    // Returns to the innermost frame that returns to target address, other targets are jumps within the subroutine
+    void count_return(Address_t target_address);
+    // Jumps to the return address of the current subroutine return from it, as in J @RETADR
+    void count_jump(Address_t target_address);
+    // Accesses are counted at their first byte
+    void count_read(Address_t address);
+    void count_write(Address_t address);
+
+    [[nodiscard]] uint64_t get_execution_count(Address_t address) const;
+    [[nodiscard]] uint64_t get_total_execution_count() const;
+    [[nodiscard]] BranchCount get_branch_count(Address_t address) const;
+    [[nodiscard]] uint64_t get_read_count(Address_t address) const;
+    [[nodiscard]] uint64_t get_write_count(Address_t address) const;
+
+    // Subroutines sorted by inclusive count
+    [[nodiscard]] std::vector<FunctionCount> get_function_counts() const;
+    [[nodiscard]] size_t get_call_depth() const;
+
+    // Hottest instructions and most accessed memory, at most limit lines each
+    void report(std::ostream& os, Disassembler& disassembler, size_t limit) const;
+    void report_functions(std::ostream& os, Disassembler& disassembler, size_t limit) const;
+    // One "root;caller;callee count" line per call path, as read by flamegraph scripts
+    void write_collapsed_stacks(std::ostream& os) const;
+
+    // Deeper calls are treated as jumps, so runaway recursion can't grow the call graph without bound
+    static constexpr size_t max_call_depth = 1024;
+private:
+    // Node of the call graph, one per distinct call path
+    struct CallNode {
+        Address_t function;
+        size_t parent;
+        uint64_t exclusive {};
+        uint64_t calls {};
+        std::unordered_map<Address_t, size_t> children {};
+    };
+
+    struct CallFrame {
+        size_t node;
+        Address_t return_address;
+    };
+
+    [[nodiscard]] std::vector<uint64_t> inclusive_counts() const;
+
+    [[nodiscard]] static std::vector<Address_t> hottest(size_t limit, const auto& count);
+
+    std::vector<uint64_t> m_executions = std::vector<uint64_t>(Memory::mem_size);
+    std::vector<uint64_t> m_reads = std::vector<uint64_t>(Memory::mem_size);
+    std::vector<uint64_t> m_writes = std::vector<uint64_t>(Memory::mem_size);
+    // Conditional jumps only
+    std::unordered_map<Address_t, BranchCount> m_branches {};
+    uint64_t m_total_executions {};
+
+    std::vector<CallNode> m_call_nodes {};
+    std::vector<CallFrame> m_call_stack {};
+};
+
+
+#endif //ASS2_PROFILER_H
@@ -5,6 +5,7 @@
 #include <cassert>
 #include <iomanip>
 #include "Registers.h"
+#include "Semantics.h"
 
 using enum Register;
 
@@ -26,8 +27,7 @@ Register_t Registers::get(Register reg) const {
 }
 
 RegisterChange Registers::set(Register reg, Register_t new_value) {
-    if (new_value & 0x800000) new_value |= 0xff000000; // NOLINT(cppcoreguidelines-narrowing-conversions)
-    else new_value &= ~0xff000000; // NOLINT(cppcoreguidelines-narrowing-conversions)
+    new_value = semantics::sign_extend(new_value);
 
     RegisterChange change {
         .register_id = reg,
@@ -128,11 +128,7 @@ Register_t Registers::getCC() const {
 }
 
 RegisterChange Registers::setCC(Register_t cc) {
-    if (cc < 0) cc = 0b01;
-    else if (cc > 0) cc = 0b10;
-    auto sw = getSw();
-    sw = (sw & ~(0b1100)) | (cc << 2);
-    return set(SW, sw);
+    return set(SW, semantics::with_condition_code(getSw(), cc));
 }
 
 bool Registers::CC_is_greater() const {
@@ -0,0 +1,55 @@
+//
+// Created by Lenart on 18/10/2026.
+//
+
+#ifndef ASS2_SEMANTICS_H
+#define ASS2_SEMANTICS_H
+
+#include "../common/Mnemonics.h"
+#include "../common/SicTypes.h"
+
+// Register arithmetic shared by Machine and LockstepGroup, so both execution paths compute the same values.
+// Registers are 24 bits wide and kept sign extended to 32.
+namespace semantics {
+    constexpr Register_t sign_extend(Register_t value) {
+        if (value & 0x800000) return static_cast<Register_t>(static_cast<uint32_t>(value) | 0xff000000);
+        return value & 0x00ffffff;
+    }
+
+    // Result of the format 2 register operations and the matching format 3/4 operations on A.
+    // Memory operands are unsigned words, which makes DIV an unsigned division.
+    template<Opcode op, class Operand>
+    constexpr Register_t arithmetic(Register_t left, Operand right) {
+        using enum Opcode;
+        if constexpr (op == ADD || op == ADDR) return static_cast<Register_t>(left + right);
+        else if constexpr (op == SUB || op == SUBR) return static_cast<Register_t>(left - right);
+        else if constexpr (op == MUL || op == MULR) return static_cast<Register_t>(left * right);
+        else if constexpr (op == DIV || op == DIVR) return static_cast<Register_t>(left / right);
+        else if constexpr (op == AND) return static_cast<Register_t>(left & right);
+        else if constexpr (op == OR) return static_cast<Register_t>(left | right);
+        else static_assert(op == ADD, "Not an arithmetic instruction");
+    }
+
+    // SHIFTL and SHIFTR rotate by count + 1 bits
+    constexpr Register_t shift_left(Register_t value, int count) {
+        return (value << (count + 1)) | ((value & 0x800000) != 0);
+    }
+
+    constexpr Register_t shift_right(Register_t value, int count) {
+        return (value >> (count + 1)) | ((value & 1) << 23);
+    }
+
+    // LDCH and RD replace the low byte of A
+    constexpr Register_t with_low_byte(Register_t value, Byte_t byte) {
+        return (value & 0xffff00) | byte;
+    }
+
+    // Status word with the condition code of comparing by difference
+    constexpr Register_t with_condition_code(Register_t sw, Register_t difference) {
+        difference = sign_extend(difference);
+        Register_t cc = difference < 0 ? 0b01 : difference > 0 ? 0b10 : 0b00;
+        return (sw & ~0b1100) | (cc << 2);
+    }
+}
+
+#endif //ASS2_SEMANTICS_H
@@ -0,0 +1,263 @@
+//
+// Created by Lenart on 17/10/2026.
+//
+
+#include <algorithm>
+#include "Trace.h"
+
+static uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+static int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+TraceRecorder::TraceRecorder(const std::string &file_name, const Registers &registers)
+    : m_stream(file_name, std::ios::binary)
+    , m_expected_pc(registers.getPc())
+{
+    m_buffer.reserve(buffer_size);
+    m_buffer.insert(m_buffer.end(), trace_format::magic.begin(), trace_format::magic.end());
+    m_buffer.push_back(trace_format::version);
+    for (auto reg : trace_format::registers) put_bytes(registers.get(reg), 4);
+
+    m_writer = std::thread(&TraceRecorder::write_buffers, this);
+}
+
+TraceRecorder::~TraceRecorder() {
+    finish_instruction();
+    hand_off();
+
+    {
+        std::lock_guard lock {m_mutex};
+        m_closing = true;
+    }
+    m_queued.notify_one();
+    m_writer.join();
+}
+
+bool TraceRecorder::is_open() const {
+    return m_stream.is_open();
+}
+
+uint64_t TraceRecorder::get_instruction_count() const {
+    return m_instruction_count;
+}
+
+void TraceRecorder::record_instruction(Address_t pc, const Memory &memory, uint8_t length) {
+    finish_instruction();
+
+    m_pending = true;
+    m_pc = pc;
+    m_length = std::clamp<uint8_t>(length, 1, 4);
+    for (uint8_t i = 0; i < m_length; i++) m_bytes[i] = memory.get_byte(pc + i);
+}
+
+void TraceRecorder::record(const RegisterChange &change) {
+    if (!m_pending || change.register_id == Register::PC) return;
+
+    // Bounded by the 4 bit count in the tag, no instruction comes close
+    if (m_register_changes.size() < 15) m_register_changes.push_back(change);
+}
+
+void TraceRecorder::record(const MemoryChange &change) {
+    if (!m_pending || change.changed_bytes_length == 0) return;
+
+    m_memory_changes.push_back(change);
+}
+
+void TraceRecorder::finish_instruction() {
+    if (!m_pending) return;
+    m_pending = false;
+
+    bool jumped = m_pc != m_expected_pc;
+    auto tag = static_cast<uint8_t>((m_length - 1) | jumped << 2 | m_register_changes.size() << 3 |
+                                    !m_memory_changes.empty() << 7);
+    m_buffer.push_back(tag);
+
+    if (jumped) put_varint(zigzag(static_cast<int64_t>(m_pc) - m_expected_pc));
+    m_buffer.insert(m_buffer.end(), m_bytes.begin(), m_bytes.begin() + m_length);
+
+    for (auto& change : m_register_changes) {
+        m_buffer.push_back(static_cast<uint8_t>(change.register_id));
+        put_varint(zigzag(static_cast<int64_t>(change.new_value) - change.previous_value));
+    }
+
+    if (!m_memory_changes.empty()) {
+        put_varint(m_memory_changes.size());
+        for (auto& change : m_memory_changes) {
+            bool is_word = change.changed_bytes_length != 1;
+            auto delta = static_cast<int64_t>(change.start_address) - m_last_memory_address;
+            put_varint(zigzag(delta) << 1 | is_word);
+            put_bytes(change.previous_value, is_word ? 3 : 1);
+            put_bytes(change.new_value, is_word ? 3 : 1);
+            m_last_memory_address = change.start_address;
+        }
+    }
+
+    m_expected_pc = m_pc + m_length;
+    m_register_changes.clear();
+    m_memory_changes.clear();
+    m_instruction_count++;
+
+    // Leaves room for the largest record
+    if (m_buffer.size() + 256 > buffer_size) hand_off();
+}
+
+void TraceRecorder::put_varint(uint64_t value) {
+    while (value >= 0x80) {
+        m_buffer.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    m_buffer.push_back(static_cast<uint8_t>(value));
+}
+
+void TraceRecorder::put_bytes(uint32_t value, uint8_t length) {
+    for (auto shift = length * 8; shift > 0;) {
+        shift -= 8;
+        m_buffer.push_back(static_cast<uint8_t>(value >> shift));
+    }
+}
+
+void TraceRecorder::hand_off() {
+    if (m_buffer.empty()) return;
+
+    std::unique_lock lock {m_mutex};
+    m_written.wait(lock, [&] { return m_queue.size() < max_queued_buffers; });
+    m_queue.push_back(std::move(m_buffer));
+    lock.unlock();
+    m_queued.notify_one();
+
+    m_buffer = {};
+    m_buffer.reserve(buffer_size);
+}
+
+void TraceRecorder::write_buffers() {
+    while (true) {
+        std::unique_lock lock {m_mutex};
+        m_queued.wait(lock, [&] { return !m_queue.empty() || m_closing; });
+        if (m_queue.empty()) break;
+
+        auto buffer = std::move(m_queue.front());
+        m_queue.pop_front();
+        lock.unlock();
+        m_written.notify_one();
+
+        m_stream.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+    }
+
+    m_stream.flush();
+}
+
+TraceReader::TraceReader(std::istream &stream) : m_stream(stream) {
+    std::array<char, trace_format::magic.size()> magic {};
+    m_stream.read(magic.data(), magic.size());
+    if (!m_stream || magic != trace_format::magic) return;
+    if (m_stream.get() != trace_format::version) return;
+
+    for (auto reg : trace_format::registers) {
+        uint32_t value;
+        if (!get_bytes(value, 4)) return;
+        m_registers.set(reg, static_cast<Register_t>(value));
+    }
+
+    m_expected_pc = m_registers.getPc();
+    m_valid = true;
+}
+
+bool TraceReader::is_valid() const {
+    return m_valid;
+}
+
+bool TraceReader::next(TraceRecord &record) {
+    if (!m_valid) return false;
+
+    auto tag = m_stream.get();
+    if (tag == std::istream::traits_type::eof()) return false;
+
+    record.index = m_index;
+    record.pc = m_expected_pc;
+    record.length = (tag & 0b11) + 1;
+    record.register_changes.clear();
+    record.memory_changes.clear();
+
+    if (tag & 0b100) {
+        uint64_t delta;
+        if (!get_varint(delta)) return false;
+        record.pc = m_expected_pc + unzigzag(delta);
+    }
+
+    for (uint8_t i = 0; i < record.length; i++) {
+        auto byte = m_stream.get();
+        if (byte == std::istream::traits_type::eof()) return false;
+        record.bytes[i] = static_cast<Byte_t>(byte);
+        m_memory->set_byte(record.pc + i, record.bytes[i]);
+    }
+
+    m_registers.setPc(record.pc + record.length);
+
+    for (auto count = (tag >> 3) & 0xf; count > 0; count--) {
+        auto reg = static_cast<Register>(m_stream.get());
+        uint64_t delta;
+        if (!get_varint(delta)) return false;
+
+        auto previous_value = m_registers.get(reg);
+        record.register_changes.push_back(m_registers.set(reg, static_cast<Register_t>(previous_value + unzigzag(delta))));
+    }
+
+    if (tag & 0x80) {
+        uint64_t count;
+        if (!get_varint(count)) return false;
+
+        for (; count > 0; count--) {
+            uint64_t address;
+            uint32_t previous_value, new_value;
+            if (!get_varint(address)) return false;
+
+            bool is_word = address & 1;
+            auto length = static_cast<uint8_t>(is_word ? 3 : 1);
+            if (!get_bytes(previous_value, length) || !get_bytes(new_value, length)) return false;
+
+            m_last_memory_address += unzigzag(address >> 1);
+            record.memory_changes.push_back(is_word
+                ? m_memory->set_word(m_last_memory_address, new_value)
+                : m_memory->set_byte(m_last_memory_address, new_value));
+            record.memory_changes.back().previous_value = previous_value;
+        }
+    }
+
+    m_expected_pc = record.pc + record.length;
+    m_index++;
+    return true;
+}
+
+const Registers &TraceReader::get_registers() const {
+    return m_registers;
+}
+
+std::shared_ptr<Memory> TraceReader::get_memory() const {
+    return m_memory;
+}
+
+bool TraceReader::get_varint(uint64_t &value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        auto byte = m_stream.get();
+        if (byte == std::istream::traits_type::eof()) return false;
+
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+bool TraceReader::get_bytes(uint32_t &value, uint8_t length) {
+    value = 0;
+    for (uint8_t i = 0; i < length; i++) {
+        auto byte = m_stream.get();
+        if (byte == std::istream::traits_type::eof()) return false;
+        value = value << 8 | byte;
+    }
+    return true;
+}
@@ -0,0 +1,129 @@
+//
+// Created by Lenart on 17/10/2026.
+//
+
+#ifndef ASS2_TRACE_H
+#define ASS2_TRACE_H
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Memory.h"
+#include "Registers.h"
+
+// Binary instruction trace, starting with the magic, a version byte and the registers at the start of the trace.
+// Each executed instruction is then a record of:
+//   tag byte: bits 0-1 length - 1, bit 2 PC is not the previous PC + length,
+//             bits 3-6 register change count, bit 7 memory changes follow
+//   [zigzag varint PC - expected PC], raw instruction bytes,
+//   per register change: register id, zigzag varint new - previous value,
+//   [varint memory change count], per memory change: zigzag varint
+//   (address - previous change address) << 1 | is word, previous bytes, new bytes.
+// PC changes are not recorded, the next record's PC tells where execution went.
+namespace trace_format {
+    static constexpr std::array<char, 8> magic { 'S', 'I', 'C', 'T', 'R', 'A', 'C', 'E' };
+    static constexpr uint8_t version = 1;
+    static constexpr std::array<Register, 9> registers {
+        Register::A, Register::X, Register::L, Register::B, Register::S,
+        Register::T, Register::F, Register::PC, Register::SW
+    };
+}
+
+// Encodes executed instructions into buffers that a background thread writes out
+class TraceRecorder {
+public:
+    TraceRecorder(const std::string& file_name, const Registers& registers);
+    // Writes out everything recorded so far
+    ~TraceRecorder();
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+    [[nodiscard]] bool is_open() const;
+    [[nodiscard]] uint64_t get_instruction_count() const;
+
+    // Starts the record of an instruction, the changes it makes follow
+    void record_instruction(Address_t pc, const Memory& memory, uint8_t length);
+    void record(const RegisterChange& change);
+    void record(const MemoryChange& change);
+
+    static constexpr size_t buffer_size = 1 << 20;
+    // The recorder waits for the writer once this many buffers are queued
+    static constexpr size_t max_queued_buffers = 4;
+private:
+    void finish_instruction();
+    void put_varint(uint64_t value);
+    void put_bytes(uint32_t value, uint8_t length);
+    void hand_off();
+    void write_buffers();
+
+    std::ofstream m_stream;
+    std::vector<uint8_t> m_buffer {};
+    uint64_t m_instruction_count {};
+
+    // Instruction being recorded
+    bool m_pending { false };
+    Address_t m_pc {};
+    uint8_t m_length {};
+    std::array<Byte_t, 4> m_bytes {};
+    std::vector<RegisterChange> m_register_changes {};
+    std::vector<MemoryChange> m_memory_changes {};
+
+    Address_t m_expected_pc {};
+    Address_t m_last_memory_address {};
+
+    std::mutex m_mutex;
+    std::condition_variable m_queued;
+    std::condition_variable m_written;
+    std::deque<std::vector<uint8_t>> m_queue {};
+    bool m_closing { false };
+    std::thread m_writer;
+};
+
+struct TraceRecord {
+    // Position in the trace, starting at 0
+    uint64_t index {};
+    Address_t pc {};
+    uint8_t length {};
+    std::array<Byte_t, 4> bytes {};
+    std::vector<RegisterChange> register_changes {};
+    std::vector<MemoryChange> memory_changes {};
+};
+
+// Reads a trace back, keeping the register state and the memory the trace has seen up to date
+class TraceReader {
+public:
+    explicit TraceReader(std::istream& stream);
+
+    // False when the stream is not a trace of a supported version
+    [[nodiscard]] bool is_valid() const;
+    // Reads the next record, false at the end of the trace
+    bool next(TraceRecord& record);
+
+    // Registers after the last record read
+    [[nodiscard]] const Registers& get_registers() const;
+    // Instruction bytes and stored values seen so far, everything else reads 0
+    [[nodiscard]] std::shared_ptr<Memory> get_memory() const;
+private:
+    [[nodiscard]] bool get_varint(uint64_t& value);
+    [[nodiscard]] bool get_bytes(uint32_t& value, uint8_t length);
+
+    std::istream& m_stream;
+    bool m_valid { false };
+    uint64_t m_index {};
+
+    Registers m_registers {};
+    std::shared_ptr<Memory> m_memory = std::make_shared<Memory>();
+    Address_t m_expected_pc {};
+    Address_t m_last_memory_address {};
+};
+
+
+#endif //ASS2_TRACE_H
@@ -0,0 +1,38 @@
+//
+// Created by Lenart on 18/10/2026.
+//
+
+#ifndef ASS2_TESTUTIL_H
+#define ASS2_TESTUTIL_H
+
+#include <initializer_list>
+#include <iostream>
+#include <memory>
+#include "../sim/Memory.h"
+
+// Reports a failed condition and keeps going, so one run shows every failure
+#define CHECK(condition) check((condition), #condition, __FILE__, __LINE__)
+
+inline int failed_checks = 0;
+
+inline void check(bool passed, const char* condition, const char* file, int line) {
+    if (passed) return;
+    std::cout << file << ":" << line << ": CHECK(" << condition << ") failed" << std::endl;
+    failed_checks++;
+}
+
+// Exit code of a test executable
+inline int test_result() {
+    if (failed_checks != 0) std::cout << failed_checks << " checks failed" << std::endl;
+    return failed_checks != 0;
+}
+
+// Memory holding the given bytes from address 0, programs are written as machine code
+inline std::shared_ptr<Memory> make_program(std::initializer_list<uint32_t> bytes) {
+    auto memory = std::make_shared<Memory>();
+    Address_t address = 0;
+    for (auto byte : bytes) memory->set_byte(address++, static_cast<Byte_t>(byte));
+    return memory;
+}
+
+#endif //ASS2_TESTUTIL_H
@@ -0,0 +1,60 @@
+//
+// Created by Lenart on 18/10/2026.
+//
+
+#include "TestUtil.h"
+#include "../sim/CacheSimulator.h"
+
+static bool parses_to(const std::string& text, size_t size, size_t line_size, size_t associativity) {
+    auto config = CacheConfig::parse(text);
+    return config && config->size == size && config->line_size == line_size && config->associativity == associativity;
+}
+
+static void test_parse() {
+    CacheConfig defaults {};
+    CHECK(parses_to("1024", 1024, defaults.line_size, defaults.associativity));
+    CHECK(parses_to("1024,32", 1024, 32, defaults.associativity));
+    CHECK(parses_to("1024,32,4", 1024, 32, 4));
+    // One set, fully associative
+    CHECK(parses_to("256,16,16", 256, 16, 16));
+
+    CHECK(!CacheConfig::parse("1000").has_value());
+    CHECK(!CacheConfig::parse("1024,24").has_value());
+    CHECK(!CacheConfig::parse("1024,32,3").has_value());
+    CHECK(!CacheConfig::parse("256,16,32").has_value());
+    CHECK(!CacheConfig::parse("1024,32,4,2").has_value());
+    CHECK(!CacheConfig::parse("1k").has_value());
+    CHECK(!CacheConfig::parse("1024,,4").has_value());
+    CHECK(!CacheConfig::parse("0").has_value());
+    CHECK(!CacheConfig::parse("99999999999999999999999").has_value());
+}
+
+// 2 sets of 2 ways with 16 byte lines, lines 0, 2 and 4 all map to set 0
+static void test_lru() {
+    CacheSimulator cache {CacheConfig {.size = 64, .line_size = 16, .associativity = 2}};
+
+    cache.access(0x00, 3);
+    cache.access(0x20, 3);
+    cache.access(0x00, 3);
+    CHECK(cache.get_stats().hits == 1);
+    CHECK(cache.get_stats().misses == 2);
+
+    // Evicts 0x20, the least recently used
+    cache.access(0x40, 3);
+    cache.access(0x00, 3);
+    cache.access(0x20, 3);
+    CHECK(cache.get_stats().hits == 2);
+    CHECK(cache.get_stats().misses == 4);
+    CHECK(cache.get_misses(0x20) == 2);
+
+    // A word across two lines counts both of them
+    cache.access(0x1f, 3);
+    CHECK(cache.get_stats().hits + cache.get_stats().misses == 8);
+    CHECK(cache.get_misses(0x1f) == 1);
+}
+
+int main() {
+    test_parse();
+    test_lru();
+    return test_result();
+}
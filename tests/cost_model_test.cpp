@@ -0,0 +1,97 @@
+//
+// Created by Lenart on 18/10/2026.
+//
+
+#include <sstream>
+#include "TestUtil.h"
+#include "../sim/CostModel.h"
+#include "../sim/Device.h"
+#include "../sim/InstructionCache.h"
+#include "../sim/Machine.h"
+
+// ADD #1, ADD 0x100, +ADD #1, RD #5 and the halting J at 13
+static std::shared_ptr<Memory> make_program_mix() {
+    return make_program({
+        0x19, 0x00, 0x01,
+        0x1B, 0x01, 0x00,
+        0x19, 0x10, 0x00, 0x01,
+        0xD9, 0x00, 0x05,
+        0x3F, 0x2F, 0xFD
+    });
+}
+
+static std::optional<CostModel> load(const std::string& text) {
+    std::stringstream stream {text};
+    return CostModel::load(stream);
+}
+
+static uint32_t cycles_at(const CostModel& model, const Memory& memory, Address_t address) {
+    return model.get_cycles(DecodedInstruction::decode(memory, address));
+}
+
+static void test_load() {
+    auto memory = make_program_mix();
+    CostModel defaults {};
+
+    auto model = load("ADD 7   # costs more\n\n   immediate 2\n# extended 9\nextended 3\n");
+    CHECK(model.has_value());
+    if (!model) return;
+    CHECK(cycles_at(*model, *memory, 0) == 9);
+    CHECK(cycles_at(*model, *memory, 3) == 7);
+    CHECK(cycles_at(*model, *memory, 6) == 12);
+    // Lines that were not given keep the defaults
+    CHECK(cycles_at(*model, *memory, 10) == cycles_at(defaults, *memory, 10) + 2);
+    CHECK(cycles_at(*model, *memory, 13) == cycles_at(defaults, *memory, 13));
+
+    CHECK(load("").has_value());
+    CHECK(!load("ADDX 3\n").has_value());
+    CHECK(!load("ADD\n").has_value());
+    CHECK(!load("ADD x\n").has_value());
+    CHECK(!load("ADD 3 4\n").has_value());
+    CHECK(!load("ADD -1\n").has_value());
+    CHECK(!load("ADD 70000\n").has_value());
+}
+
+static void test_write_round_trip() {
+    auto memory = make_program_mix();
+    auto model = load("ADD 11\nRD 5\ndevice 1\nindirect 0\n");
+    CHECK(model.has_value());
+    if (!model) return;
+
+    std::stringstream stream {};
+    model->write(stream);
+    auto reloaded = CostModel::load(stream);
+    CHECK(reloaded.has_value());
+    if (!reloaded) return;
+    for (Address_t address : {0, 3, 6, 10, 13}) {
+        CHECK(cycles_at(*reloaded, *memory, address) == cycles_at(*model, *memory, address));
+    }
+}
+
+// Undo takes back what the instruction was charged, even after the model changed
+static void test_undo_after_model_change() {
+    auto memory = make_program_mix();
+    Machine machine {0, memory};
+    machine.set_device(5, std::make_unique<MemoryDevice>("x"));
+    for (int i = 0; i < 3; i++) machine.step();
+    auto cycles = machine.get_cycle_count();
+    CHECK(cycles == 4 + 4 + 5);
+
+    auto model = load("ADD 100\n");
+    CHECK(model.has_value());
+    if (!model) return;
+    machine.set_cost_model(*model);
+    machine.step();
+    CHECK(machine.get_cycle_count() == cycles + cycles_at(*model, *memory, 10));
+
+    while (machine.can_undo()) machine.undo();
+    CHECK(machine.get_instruction_count() == 0);
+    CHECK(machine.get_cycle_count() == 0);
+}
+
+int main() {
+    test_load();
+    test_write_round_trip();
+    test_undo_after_model_change();
+    return test_result();
+}
@@ -0,0 +1,113 @@
+//
+// Created by Lenart on 18/10/2026.
+//
+
+#include <sstream>
+#include "TestUtil.h"
+#include "../sim/Device.h"
+#include "../sim/Machine.h"
+
+// Three RD #5, a WD #6 of the last byte read, then halts at 12
+static std::shared_ptr<Memory> make_echo() {
+    return make_program({
+        0xD9, 0x00, 0x05,
+        0xD9, 0x00, 0x05,
+        0xD9, 0x00, 0x05,
+        0xDD, 0x00, 0x06,
+        0x3F, 0x2F, 0xFD
+    });
+}
+
+// Runs the program with the given input on device 5 and returns what it wrote to device 6
+static std::string run_echo(Machine& machine, const std::string& input) {
+    auto output = std::make_unique<MemoryDevice>();
+    auto& written = *output;
+    machine.set_device(5, std::make_unique<MemoryDevice>(input));
+    machine.set_device(6, std::move(output));
+    machine.run();
+    CHECK(machine.in_halt_condition());
+    return written.get_output();
+}
+
+static std::string record(const std::string& input) {
+    Machine machine {0, make_echo()};
+    CHECK(run_echo(machine, input) == input.substr(2, 1));
+    CHECK(machine.get_device_event_count() == 4);
+
+    std::stringstream log {};
+    machine.save_device_log(log);
+    return log.str();
+}
+
+static void test_replay() {
+    std::stringstream log {record("xyz")};
+
+    // Reads come from the log, the write still reaches the device
+    Machine machine {0, make_echo()};
+    CHECK(machine.replay_device_log(log));
+    CHECK(run_echo(machine, "abc") == "z");
+    CHECK(machine.get_registers().getA() == 'z');
+}
+
+static void test_replay_with_logging_off() {
+    std::stringstream log {record("xyz")};
+
+    Machine machine {0, make_echo()};
+    machine.set_device_logging(false);
+    CHECK(machine.replay_device_log(log));
+    CHECK(run_echo(machine, "abc") == "z");
+}
+
+// Travelling back and running again replays the reads instead of reading further input
+static void test_reverse_replays() {
+    Machine machine {0, make_echo()};
+    CHECK(run_echo(machine, "xyz") == "z");
+
+    CHECK(machine.reverse_step(4));
+    CHECK(machine.get_registers().getA() == 'x');
+    machine.run();
+    CHECK(machine.get_registers().getA() == 'z');
+    CHECK(machine.get_device_event_count() == 4);
+}
+
+static void test_replay_rejected() {
+    std::stringstream log {record("xyz")};
+    Machine started {0, make_echo()};
+    started.set_device(5, std::make_unique<MemoryDevice>("abc"));
+    started.step();
+    CHECK(!started.replay_device_log(log));
+
+    std::stringstream garbage {"not a device log"};
+    Machine machine {0, make_echo()};
+    CHECK(!machine.replay_device_log(garbage));
+}
+
+static void test_file_round_trip() {
+    std::vector<DeviceEvent> events {
+        {.instruction_count = 1, .device_id = 5, .access = DeviceAccess::Read, .value = 'x'},
+        {.instruction_count = 300, .device_id = 6, .access = DeviceAccess::Write, .value = 0xff},
+        {.instruction_count = 1ull << 40, .device_id = 255, .access = DeviceAccess::Test, .value = 1}
+    };
+    std::stringstream stream {};
+    device_log::write(stream, events);
+
+    auto read = device_log::read(stream);
+    CHECK(read.has_value());
+    if (!read) return;
+    CHECK(read->size() == events.size());
+    for (size_t i = 0; i < std::min(read->size(), events.size()); i++) {
+        CHECK((*read)[i].instruction_count == events[i].instruction_count);
+        CHECK((*read)[i].device_id == events[i].device_id);
+        CHECK((*read)[i].access == events[i].access);
+        CHECK((*read)[i].value == events[i].value);
+    }
+}
+
+int main() {
+    test_replay();
+    test_replay_with_logging_off();
+    test_reverse_replays();
+    test_replay_rejected();
+    test_file_round_trip();
+    return test_result();
+}
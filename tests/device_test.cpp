@@ -0,0 +1,281 @@
+//
+// Created by Lenart on 18/10/2026.
+//
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include "TestUtil.h"
+#include "../sim/Device.h"
+#include "../sim/Machine.h"
+
+// RD #5, WD #5, RD #5, WD #5, then halts at 12
+static std::shared_ptr<Memory> make_interleave() {
+    return make_program({
+        0xD9, 0x00, 0x05,
+        0xDD, 0x00, 0x05,
+        0xD9, 0x00, 0x05,
+        0xDD, 0x00, 0x05,
+        0x3F, 0x2F, 0xFD
+    });
+}
+
+// WD #6 and a jump back to it, forever
+static std::shared_ptr<Memory> make_write_loop() {
+    return make_program({
+        0xDD, 0x00, 0x06,
+        0x3F, 0x2F, 0xFA
+    });
+}
+
+// WD #1 three times, then halts at 9
+static std::shared_ptr<Memory> make_console_write() {
+    return make_program({
+        0xDD, 0x00, 0x01,
+        0xDD, 0x00, 0x01,
+        0xDD, 0x00, 0x01,
+        0x3F, 0x2F, 0xFD
+    });
+}
+
+// RD #5, WD #6, RD #5, TD #7, then halts at 12
+static std::shared_ptr<Memory> make_device_table() {
+    return make_program({
+        0xD9, 0x00, 0x05,
+        0xDD, 0x00, 0x06,
+        0xD9, 0x00, 0x05,
+        0xE1, 0x00, 0x07,
+        0x3F, 0x2F, 0xFD
+    });
+}
+
+static std::string read_file(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    std::stringstream contents {};
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+// Stands in for std::cout's buffer and counts how often it is flushed
+class SyncCounter : public std::stringbuf {
+public:
+    SyncCounter()
+        : m_previous(std::cout.rdbuf(this))
+    {}
+
+    ~SyncCounter() override {
+        std::cout.rdbuf(m_previous);
+    }
+
+    int syncs {};
+
+protected:
+    int sync() override {
+        syncs++;
+        return std::stringbuf::sync();
+    }
+
+private:
+    std::streambuf* m_previous;
+};
+
+// Device files are opened relative to the working directory
+class ScratchDirectory {
+public:
+    ScratchDirectory()
+        : m_directory(std::filesystem::temp_directory_path() / "ass2_device_test")
+        , m_previous_directory(std::filesystem::current_path())
+    {
+        std::filesystem::create_directories(m_directory);
+        std::filesystem::current_path(m_directory);
+    }
+
+    ~ScratchDirectory() {
+        std::filesystem::current_path(m_previous_directory);
+        std::filesystem::remove_all(m_directory);
+    }
+
+private:
+    std::filesystem::path m_directory;
+    std::filesystem::path m_previous_directory;
+};
+
+// Each write lands after the byte just read, the last one stays buffered until the halt
+static void test_file_interleave(ExecutionEngine engine) {
+    ScratchDirectory directory {};
+    std::ofstream("05.dev", std::ios::binary) << "abcdef";
+
+    Machine machine {0, make_interleave(), engine};
+    for (int i = 0; i < 4; i++) machine.step();
+    CHECK((machine.get_registers().getA() & 0xff) == 'c');
+    CHECK(read_file("05.dev") != "aaccef");
+
+    machine.step();
+    CHECK(machine.in_halt_condition());
+    CHECK(read_file("05.dev") == "aaccef");
+}
+
+static void test_file_sync() {
+    ScratchDirectory directory {};
+    std::ofstream("05.dev", std::ios::binary) << "abcdef";
+
+    Machine machine {0, make_interleave()};
+    for (int i = 0; i < 4; i++) machine.step();
+    CHECK(read_file("05.dev") != "aaccef");
+
+    machine.flush_devices();
+    CHECK(read_file("05.dev") == "aaccef");
+    CHECK(!machine.in_halt_condition());
+}
+
+// A WD first truncates the file, a full buffer is written out without a flush
+static void test_file_buffer_threshold() {
+    ScratchDirectory directory {};
+    std::ofstream("06.dev", std::ios::binary) << "old contents";
+
+    Machine machine {0, make_write_loop()};
+    machine.set_change_recording(false);
+    machine.set_register(Register::A, 'w');
+    machine.step();
+    machine.step();
+    CHECK(read_file("06.dev").empty());
+
+    for (size_t i = 1; i < FileDevice::buffer_size + 1; i++) {
+        machine.step();
+        machine.step();
+    }
+    auto written = read_file("06.dev");
+    CHECK(written.size() >= FileDevice::buffer_size);
+    CHECK(written.find_first_not_of('w') == std::string::npos);
+
+    machine.flush_devices();
+    CHECK(read_file("06.dev").size() == FileDevice::buffer_size + 1);
+}
+
+// Reading past the end fails the device, writes made before still reach the file
+static void test_file_end() {
+    ScratchDirectory directory {};
+    std::ofstream("05.dev", std::ios::binary) << "a";
+
+    Machine machine {0, make_interleave()};
+    machine.run();
+    CHECK(machine.in_halt_condition());
+    CHECK(read_file("05.dev") == "aa");
+}
+
+// Checks run after the counter is gone, failures inside its scope would go to its buffer
+struct ConsoleRun {
+    std::string output;
+    std::vector<int> syncs;
+};
+
+static ConsoleRun console_run(FlushPolicy flush_policy, const std::string& text) {
+    SyncCounter counter {};
+    StdoutDevice device {flush_policy};
+    for (auto c : text) device.write(c);
+    auto syncs = counter.syncs;
+    device.flush();
+    return { counter.str(), { syncs, counter.syncs } };
+}
+
+static void test_flush_policy() {
+    auto unbuffered = console_run(FlushPolicy::Unbuffered, "ab\ncd\n");
+    CHECK(unbuffered.output == "ab\ncd\n");
+    CHECK(unbuffered.syncs[0] == 6);
+
+    CHECK(console_run(FlushPolicy::Line, "ab\ncd\n").syncs[0] == 2);
+    CHECK(console_run(FlushPolicy::Line, "abcd").syncs[0] == 0);
+
+    auto full = console_run(FlushPolicy::Full, "ab\ncd\n");
+    CHECK(full.output == "ab\ncd\n");
+    CHECK(full.syncs[0] == 0);
+    CHECK(full.syncs[1] == 1);
+}
+
+// Fully buffered output is flushed once the program halts or stops on a breakpoint
+static void test_console_stop_flush(ExecutionEngine engine) {
+    Machine machine {0, make_console_write(), engine};
+    machine.set_device(1, std::make_unique<StdoutDevice>(FlushPolicy::Full));
+    machine.set_register(Register::A, 'x');
+
+    ConsoleRun run {};
+    {
+        SyncCounter counter {};
+        machine.step();
+        run.syncs.push_back(counter.syncs);
+        machine.set_execution_breakpoint(6);
+        machine.run();
+        run.syncs.push_back(counter.syncs);
+
+        machine.clear_execution_breakpoints();
+        machine.step();
+        run.syncs.push_back(counter.syncs);
+        machine.step();
+        run.syncs.push_back(counter.syncs);
+        run.output = counter.str();
+    }
+
+    CHECK(run.syncs[0] == 0);
+    CHECK(run.syncs[1] > 0);
+    CHECK(run.syncs[3] > run.syncs[2]);
+    CHECK(machine.in_halt_condition());
+    CHECK(run.output == "xxx");
+}
+
+// The factory is asked once per device, attached devices are used as they are
+static void test_device_factory(ExecutionEngine engine) {
+    std::vector<std::pair<Byte_t, bool>> requests {};
+    Machine machine {0, make_device_table(), engine};
+    machine.set_device(7, std::make_unique<MemoryDevice>());
+    machine.set_device_factory([&](Byte_t id, bool for_write) -> std::unique_ptr<Device> {
+        requests.emplace_back(id, for_write);
+        if (id == 5) return std::make_unique<MemoryDevice>("kl");
+        return nullptr;
+    });
+
+    machine.step();
+    CHECK((machine.get_registers().getA() & 0xff) == 'k');
+    machine.step();
+    machine.step();
+    CHECK((machine.get_registers().getA() & 0xff) == 'l');
+    machine.step();
+    CHECK(machine.get_registers().CC_is_equal());
+    machine.step();
+    CHECK(machine.in_halt_condition());
+
+    CHECK(requests.size() == 2);
+    CHECK(requests[0] == std::make_pair(Byte_t {5}, false));
+    CHECK(requests[1] == std::make_pair(Byte_t {6}, true));
+}
+
+// Without a factory RD reads 0, WD is dropped and TD fails
+static void test_absent_devices() {
+    Machine machine {0, make_device_table()};
+    machine.set_device_factory(nullptr);
+    machine.set_register(Register::A, 0x123456);
+
+    machine.step();
+    CHECK(machine.get_registers().getA() == 0x123400);
+    machine.step();
+    machine.step();
+    CHECK(machine.run_until(100, stop_on(StopReason::DeviceWait)) == StopReason::DeviceWait);
+    CHECK(machine.get_registers().CC_is_lower());
+    CHECK(machine.get_registers().getPc() == 12);
+}
+
+int main() {
+    for (auto engine : {ExecutionEngine::Interpreter, ExecutionEngine::Threaded, ExecutionEngine::BasicBlock}) {
+        test_file_interleave(engine);
+    }
+    test_file_sync();
+    test_file_buffer_threshold();
+    test_file_end();
+    test_flush_policy();
+    for (auto engine : {ExecutionEngine::Interpreter, ExecutionEngine::Threaded, ExecutionEngine::BasicBlock}) {
+        test_console_stop_flush(engine);
+        test_device_factory(engine);
+    }
+    test_absent_devices();
+    return test_result();
+}
@@ -0,0 +1,149 @@
+//
+// Created by Lenart on 18/10/2026.
+//
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include "TestUtil.h"
+#include "../sim/Device.h"
+#include "../sim/Machine.h"
+
+// ADD #1 three times, STA 0x100, ADD #1, STA 0x100, then halts at 18
+static std::shared_ptr<Memory> make_counter() {
+    return make_program({
+        0x19, 0x00, 0x01,
+        0x19, 0x00, 0x01,
+        0x19, 0x00, 0x01,
+        0x0F, 0x01, 0x00,
+        0x19, 0x00, 0x01,
+        0x0F, 0x01, 0x00,
+        0x3F, 0x2F, 0xFD
+    });
+}
+
+// RD #5 twice, WD #5, then halts at 9
+static std::shared_ptr<Memory> make_copy() {
+    return make_program({
+        0xD9, 0x00, 0x05,
+        0xD9, 0x00, 0x05,
+        0xDD, 0x00, 0x05,
+        0x3F, 0x2F, 0xFD
+    });
+}
+
+static std::string read_file(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    std::stringstream contents {};
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+// Stores in either machine stay out of the other's memory
+static void test_copy_on_write(ExecutionEngine engine) {
+    Machine parent {0, make_counter(), engine};
+    parent.step();
+    parent.step();
+    parent.step();
+    parent.step();
+    CHECK(parent.get_memory()->get_word(0x100) == 3);
+
+    auto child = parent.fork();
+    CHECK(child->get_memory() != parent.get_memory());
+    CHECK(child->get_instruction_count() == 4);
+    CHECK(child->get_registers().getA() == 3);
+
+    child->set_register(Register::A, 10);
+    child->run();
+    CHECK(child->in_halt_condition());
+    CHECK(child->get_memory()->get_word(0x100) == 11);
+    CHECK(parent.get_memory()->get_word(0x100) == 3);
+    CHECK(parent.get_registers().getA() == 3);
+
+    parent.run();
+    CHECK(parent.get_memory()->get_word(0x100) == 4);
+    CHECK(child->get_memory()->get_word(0x100) == 11);
+}
+
+// The child keeps the history from before the fork, through the journal or the checkpoints
+static void test_reverse_past_fork(bool record_changes) {
+    Machine parent {0, make_counter()};
+    parent.set_change_recording(record_changes);
+    parent.set_checkpoint_interval(2);
+    parent.step();
+    parent.step();
+    parent.step();
+    parent.step();
+
+    auto child = parent.fork();
+    child->run();
+    CHECK(child->get_instruction_count() == 7);
+
+    CHECK(child->reverse_step(6));
+    CHECK(child->get_instruction_count() == 1);
+    CHECK(child->get_registers().getA() == 1);
+    CHECK(child->get_registers().getPc() == 3);
+    CHECK(child->get_memory()->get_word(0x100) == 0);
+
+    child->run();
+    CHECK(child->in_halt_condition());
+    CHECK(child->get_memory()->get_word(0x100) == 4);
+
+    CHECK(parent.get_instruction_count() == 4);
+    CHECK(parent.get_memory()->get_word(0x100) == 3);
+}
+
+// The cloned device continues from the parent's read position, then each reads on its own
+static void test_device_cursor(ExecutionEngine engine) {
+    Machine parent {0, make_copy(), engine};
+    parent.set_device(5, std::make_unique<MemoryDevice>("abc"));
+    parent.step();
+    CHECK((parent.get_registers().getA() & 0xff) == 'a');
+
+    auto child = parent.fork();
+    parent.step();
+    CHECK((parent.get_registers().getA() & 0xff) == 'b');
+    child->step();
+    CHECK((child->get_registers().getA() & 0xff) == 'b');
+}
+
+// The fork reads the rest of the file, but its writes never reach it
+static void test_file_device_fork() {
+    auto directory = std::filesystem::temp_directory_path() / "ass2_fork_test";
+    std::filesystem::create_directories(directory);
+    auto previous_directory = std::filesystem::current_path();
+    std::filesystem::current_path(directory);
+    std::ofstream("05.dev", std::ios::binary) << "xyz";
+
+    {
+        Machine parent {0, make_copy()};
+        parent.step();
+        CHECK((parent.get_registers().getA() & 0xff) == 'x');
+
+        auto child = parent.fork();
+        child->step();
+        CHECK((child->get_registers().getA() & 0xff) == 'y');
+        child->set_register(Register::A, 'q');
+        child->run();
+        CHECK(child->in_halt_condition());
+        child->flush_devices();
+        CHECK(read_file("05.dev") == "xyz");
+
+        parent.run();
+        CHECK(read_file("05.dev") == "xyy");
+    }
+
+    std::filesystem::current_path(previous_directory);
+    std::filesystem::remove_all(directory);
+}
+
+int main() {
+    for (auto engine : {ExecutionEngine::Interpreter, ExecutionEngine::Threaded, ExecutionEngine::BasicBlock}) {
+        test_copy_on_write(engine);
+        test_device_cursor(engine);
+    }
+    test_reverse_past_fork(true);
+    test_reverse_past_fork(false);
+    test_file_device_fork();
+    return test_result();
+}
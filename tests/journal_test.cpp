@@ -0,0 +1,80 @@
+//
+// Created by Lenart on 18/10/2026.
+//
+
+#include "TestUtil.h"
+#include "../sim/ChangeJournal.h"
+#include "../sim/Machine.h"
+
+static void test_round_trip() {
+    ChangeJournal journal {};
+    CHECK(journal.capacity() == ChangeJournal::default_capacity);
+    CHECK(journal.empty());
+
+    journal.push(ChangeStart {.pc = 0x123456, .cycles = 70000});
+    journal.push(RegisterChange {.register_id = Register::A, .previous_value = -1, .new_value = 0x7fffff});
+    journal.push(MemoryChange {.start_address = 0x100, .changed_bytes_length = 3, .previous_value = 0xabcdef, .new_value = 0x123456});
+    CHECK(journal.size() == 4);
+
+    auto memory = std::get<MemoryChange>(journal.back());
+    CHECK(memory.start_address == 0x100 && memory.changed_bytes_length == 3);
+    CHECK(memory.previous_value == 0xffabcdef && memory.new_value == 0x123456);
+    journal.pop_back();
+
+    auto reg = std::get<RegisterChange>(journal.back());
+    CHECK(reg.register_id == Register::A && reg.previous_value == -1 && reg.new_value == 0x7fffff);
+    journal.pop_back();
+
+    auto start = std::get<ChangeStart>(journal.back());
+    CHECK(start.pc == 0x123456 && start.cycles == 70000);
+    journal.pop_back();
+    CHECK(journal.empty());
+}
+
+// Once full, whole steps are dropped from the oldest end
+static void test_wrap() {
+    ChangeJournal journal {ChangeJournal::min_capacity};
+    for (Address_t step = 0; step < 100; step++) {
+        journal.push(ChangeStart {.pc = step, .cycles = 1});
+        journal.push(RegisterChange {.register_id = Register::X, .previous_value = 0, .new_value = 1});
+        journal.push(RegisterChange {.register_id = Register::A, .previous_value = 0, .new_value = 1});
+    }
+    CHECK(journal.size() <= journal.capacity());
+    CHECK(journal.get_pushed_record_count() == 300);
+
+    size_t steps = 0;
+    Address_t last_pc = 100;
+    journal.for_each_newest_first([&](const Change_t& change) {
+        if (!std::holds_alternative<ChangeStart>(change)) return;
+        steps++;
+        CHECK(std::get<ChangeStart>(change).pc == last_pc - 1);
+        last_pc = std::get<ChangeStart>(change).pc;
+    });
+    CHECK(steps * 3 == journal.size());
+}
+
+// ADD #1 four times, then halts at 12
+static void test_machine_undo_window() {
+    Machine machine {0, make_program({
+        0x19, 0x00, 0x01,
+        0x19, 0x00, 0x01,
+        0x19, 0x00, 0x01,
+        0x19, 0x00, 0x01,
+        0x3F, 0x2F, 0xFD
+    })};
+    machine.set_journal_capacity(ChangeJournal::min_capacity);
+    machine.run();
+
+    uint64_t undone = 0;
+    for (; machine.can_undo(); undone++) machine.undo();
+    CHECK(undone == 5);
+    CHECK(machine.get_registers().getA() == 0);
+    CHECK(machine.get_cycle_count() == 0);
+}
+
+int main() {
+    test_round_trip();
+    test_wrap();
+    test_machine_undo_window();
+    return test_result();
+}
@@ -0,0 +1,105 @@
+//
+// Created by Lenart on 18/10/2026.
+//
+
+#include "TestUtil.h"
+#include "../sim/LockstepGroup.h"
+
+// RD #0 and COMP #'A', then JEQ splits the lanes into two endless loops. Lanes that
+// read 'A' add 2 per iteration from 15, the rest add 1 from 9.
+static std::shared_ptr<Memory> make_split() {
+    return make_program({
+        0xD9, 0x00, 0x00,
+        0x29, 0x00, 0x41,
+        0x33, 0x20, 0x06,
+        0x19, 0x00, 0x01,
+        0x3F, 0x2F, 0xFA,
+        0x19, 0x00, 0x02,
+        0x3F, 0x2F, 0xFA
+    });
+}
+
+// Shifts, register arithmetic, DIV and COMP, then halts at 20
+static std::shared_ptr<Memory> make_arithmetic() {
+    return make_program({
+        0x01, 0x01, 0x23,
+        0xA4, 0x02,
+        0xA8, 0x00,
+        0xAC, 0x01,
+        0x98, 0x10,
+        0x1D, 0x07, 0xFF,
+        0x25, 0x00, 0x03,
+        0x29, 0x00, 0x00,
+        0x3F, 0x2F, 0xFD
+    });
+}
+
+static std::vector<BatchJob> split_jobs() {
+    return {
+        BatchJob {.devices = {{0, "A"}}},
+        BatchJob {.devices = {{0, "B"}}},
+        BatchJob {.devices = {{0, "B"}}}
+    };
+}
+
+// The lanes diverge on the JEQ, the third instruction
+static void test_peel_on_last_instruction() {
+    auto image = make_split();
+    auto jobs = split_jobs();
+    auto results = LockstepGroup {*image, 0, 3}.run(jobs);
+
+    CHECK(results.size() == 3);
+    for (auto& result : results) {
+        CHECK(!result.halted);
+        CHECK(result.instruction_count == 3);
+        CHECK(result.lockstep_instruction_count == 3);
+    }
+    CHECK(results[0].registers.getPc() == 15);
+    CHECK(results[1].registers.getPc() == 9);
+}
+
+static void test_peel_remaining_budget() {
+    auto image = make_split();
+    auto jobs = split_jobs();
+    auto results = LockstepGroup {*image, 0, 7}.run(jobs);
+
+    CHECK(results.size() == 3);
+    for (auto& result : results) {
+        CHECK(!result.halted);
+        CHECK(result.instruction_count == 7);
+    }
+    CHECK(results[0].registers.getA() == 'A' + 4);
+    CHECK(results[1].registers.getA() == 'B' + 2);
+    CHECK(results[2].registers.getA() == 'B' + 2);
+
+    // The first lane takes the minority side of the JEQ, the other two stay in lockstep
+    CHECK(results[0].lockstep_instruction_count == 3);
+    CHECK(results[1].lockstep_instruction_count == 7);
+    CHECK(results[2].lockstep_instruction_count == 7);
+}
+
+static void test_same_as_machine() {
+    auto image = make_arithmetic();
+    std::vector<BatchJob> jobs(2);
+    auto results = LockstepGroup {*image, 0, 0}.run(jobs);
+
+    Machine machine {0, std::make_shared<Memory>(*image)};
+    machine.run_until(100, 0);
+    CHECK(machine.in_halt_condition());
+
+    for (auto& result : results) {
+        CHECK(result.halted);
+        CHECK(result.instruction_count == machine.get_instruction_count());
+        CHECK(result.lockstep_instruction_count == result.instruction_count);
+        for (auto reg : {Register::A, Register::X, Register::SW, Register::PC}) {
+            CHECK(result.registers.get(reg) == machine.get_registers().get(reg));
+        }
+    }
+}
+
+int main() {
+    test_peel_on_last_instruction();
+    test_peel_remaining_budget();
+    test_same_as_machine();
+    return test_result();
+}
@@ -0,0 +1,103 @@
+//
+// Created by Lenart on 18/10/2026.
+//
+
+#include <sstream>
+#include "TestUtil.h"
+#include "../sim/Disassembler.h"
+#include "../sim/Machine.h"
+#include "../sim/Profiler.h"
+
+// Calls the subroutine at 12 twice and halts at 6. It saves L, calls the one at 9, which only returns,
+// then restores L and returns.
+static std::shared_ptr<Memory> make_calls() {
+    return make_program({
+        0x4B, 0x20, 0x09,
+        0x4B, 0x20, 0x06,
+        0x3F, 0x2F, 0xFD,
+        0x4F, 0x00, 0x00,
+        0x17, 0x00, 0x1E,
+        0x4B, 0x2F, 0xF7,
+        0x0B, 0x00, 0x1E,
+        0x4F, 0x00, 0x00
+    });
+}
+
+static const FunctionCount* find_function(const std::vector<FunctionCount>& functions, Address_t address) {
+    for (auto& function : functions) {
+        if (function.address == address) return &function;
+    }
+    return nullptr;
+}
+
+static void test_call_attribution(ExecutionEngine engine) {
+    Machine machine {0, make_calls(), engine};
+    machine.set_profiling(true);
+    machine.run();
+    CHECK(machine.in_halt_condition());
+
+    auto profile = machine.get_profile();
+    CHECK(profile->get_total_execution_count() == 13);
+    CHECK(profile->get_execution_count(12) == 2);
+    CHECK(profile->get_call_depth() == 0);
+
+    // Each instruction counts for the subroutine it is in, JSUB for the caller and RSUB for the callee
+    auto functions = profile->get_function_counts();
+    CHECK(functions.size() == 3);
+    auto root = find_function(functions, 0);
+    auto outer = find_function(functions, 12);
+    auto inner = find_function(functions, 9);
+    CHECK(root && outer && inner);
+    if (!root || !outer || !inner) return;
+
+    CHECK(root->exclusive == 3);
+    CHECK(root->inclusive == 13);
+    CHECK(outer->exclusive == 8);
+    CHECK(outer->inclusive == 10);
+    CHECK(outer->calls == 2);
+    CHECK(inner->exclusive == 2);
+    CHECK(inner->inclusive == 2);
+    CHECK(inner->calls == 2);
+    CHECK(functions.front().address == 0);
+
+    std::stringstream stacks {};
+    profile->write_collapsed_stacks(stacks);
+    CHECK(stacks.str() == "0x000000 3\n0x000000;0x00000c 8\n0x000000;0x00000c;0x000009 2\n");
+}
+
+// Without the journal time travel re-executes from the program start, which is not counted
+static void test_reverse_not_counted() {
+    Machine machine {0, make_calls()};
+    machine.set_change_recording(false);
+    machine.set_profiling(true);
+    machine.run();
+    CHECK(machine.reverse_step(5));
+    machine.run();
+    CHECK(machine.get_profile()->get_total_execution_count() == 18);
+}
+
+// The report leaves the caller's stream formatting as it found it
+static void test_report_format() {
+    auto memory = make_calls();
+    Machine machine {0, memory};
+    machine.set_profiling(true);
+    machine.run();
+
+    Disassembler disassembler {memory};
+    std::stringstream report {};
+    machine.get_profile()->report(report, disassembler, 3);
+    CHECK(report.str().find("15.38% ") != std::string::npos);
+
+    report.str({});
+    report << 0.5;
+    CHECK(report.str() == "0.5");
+}
+
+int main() {
+    for (auto engine : {ExecutionEngine::Interpreter, ExecutionEngine::Threaded, ExecutionEngine::BasicBlock}) {
+        test_call_attribution(engine);
+    }
+    test_reverse_not_counted();
+    test_report_format();
+    return test_result();
+}
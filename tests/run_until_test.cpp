@@ -0,0 +1,96 @@
+//
+// Created by Lenart on 18/10/2026.
+//
+
+#include <limits>
+#include "TestUtil.h"
+#include "../sim/Machine.h"
+
+static constexpr uint64_t no_limit = std::numeric_limits<uint64_t>::max();
+
+// Four ADD #1 and a J back to the first, forever
+static std::shared_ptr<Memory> make_loop() {
+    return make_program({
+        0x19, 0x00, 0x01,
+        0x19, 0x00, 0x01,
+        0x19, 0x00, 0x01,
+        0x19, 0x00, 0x01,
+        0x3F, 0x2F, 0xF1
+    });
+}
+
+// ADD #1 twice, STA 0x100, TD #5, then halts at 12
+static std::shared_ptr<Memory> make_straight() {
+    return make_program({
+        0x19, 0x00, 0x01,
+        0x19, 0x00, 0x01,
+        0x0F, 0x01, 0x00,
+        0xE1, 0x00, 0x05,
+        0x3F, 0x2F, 0xFD
+    });
+}
+
+// Limits that end inside a block and after the loop became hot
+static void test_budget(ExecutionEngine engine) {
+    Machine machine {0, make_loop(), engine};
+    for (uint64_t limit : {1, 7, 1003, 100000}) {
+        CHECK(machine.run_until(limit, 0) == StopReason::Budget);
+        CHECK(machine.get_instruction_count() == limit);
+    }
+    CHECK(machine.get_registers().getA() == 80000);
+
+    // A limit that was already reached runs nothing
+    CHECK(machine.run_until(10, 0) == StopReason::Budget);
+    CHECK(machine.get_instruction_count() == 100000);
+}
+
+static void test_stop_reasons(ExecutionEngine engine) {
+    {
+        Machine machine {0, make_straight(), engine};
+        CHECK(machine.run_until(no_limit, 0) == StopReason::Halted);
+        CHECK(machine.get_instruction_count() == 5);
+        CHECK(machine.run_until(no_limit, 0) == StopReason::Halted);
+        CHECK(machine.get_instruction_count() == 5);
+    }
+    {
+        // Breakpoints stop in front of the instruction and only when asked for
+        Machine machine {0, make_straight(), engine};
+        machine.set_execution_breakpoint(6);
+        CHECK(machine.run_until(no_limit, stop_on(StopReason::Breakpoint)) == StopReason::Breakpoint);
+        CHECK(machine.get_instruction_count() == 2);
+        CHECK(machine.get_registers().getPc() == 6);
+        machine.step();
+        CHECK(machine.run_until(no_limit, stop_on(StopReason::Breakpoint)) == StopReason::Halted);
+
+        Machine skipping {0, make_straight(), engine};
+        skipping.set_execution_breakpoint(6);
+        CHECK(skipping.run_until(no_limit, 0) == StopReason::Halted);
+    }
+    {
+        // Watchpoints stop after the instruction
+        Machine machine {0, make_straight(), engine};
+        machine.set_watchpoint(0x100, 3, WatchKind::Write);
+        CHECK(machine.run_until(no_limit, stop_on(StopReason::Watchpoint)) == StopReason::Watchpoint);
+        CHECK(machine.get_instruction_count() == 3);
+        CHECK(machine.get_watch_hit().has_value());
+    }
+    {
+        // Device 5 was never set, so TD finds it not ready
+        Machine machine {0, make_straight(), engine};
+        auto mask = StopReason::Breakpoint | StopReason::DeviceWait;
+        CHECK(machine.run_until(no_limit, mask) == StopReason::DeviceWait);
+        CHECK(machine.get_instruction_count() == 4);
+        CHECK(machine.run_until(no_limit, mask) == StopReason::Halted);
+
+        Machine waiting {0, make_straight(), engine};
+        CHECK(waiting.run_until(no_limit, 0) == StopReason::Halted);
+    }
+}
+
+int main() {
+    for (auto engine : {ExecutionEngine::Interpreter, ExecutionEngine::Threaded, ExecutionEngine::BasicBlock}) {
+        test_budget(engine);
+        test_stop_reasons(engine);
+    }
+    return test_result();
+}
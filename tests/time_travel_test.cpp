@@ -0,0 +1,116 @@
+//
+// Created by Lenart on 18/10/2026.
+//
+
+#include "TestUtil.h"
+#include "../sim/Device.h"
+#include "../sim/Machine.h"
+
+// ADD #1 three times, STA 0x100, ADD #1, STA 0x100, then halts at 18
+static std::shared_ptr<Memory> make_counter() {
+    return make_program({
+        0x19, 0x00, 0x01,
+        0x19, 0x00, 0x01,
+        0x19, 0x00, 0x01,
+        0x0F, 0x01, 0x00,
+        0x19, 0x00, 0x01,
+        0x0F, 0x01, 0x00,
+        0x3F, 0x2F, 0xFD
+    });
+}
+
+// TD #5 and a jump back to it, forever
+static std::shared_ptr<Memory> make_poll_loop() {
+    return make_program({
+        0xE1, 0x00, 0x05,
+        0x3F, 0x2F, 0xFA
+    });
+}
+
+static void test_reverse_execution(ExecutionEngine engine) {
+    Machine machine {0, make_counter(), engine};
+    machine.run();
+    CHECK(machine.in_halt_condition());
+    CHECK(machine.get_instruction_count() == 7);
+    CHECK(machine.get_registers().getA() == 4);
+
+    CHECK(machine.reverse_step(3));
+    CHECK(machine.get_instruction_count() == 4);
+    CHECK(machine.get_registers().getA() == 3);
+    CHECK(machine.get_memory()->get_word(0x100) == 3);
+    CHECK(!machine.in_halt_condition());
+
+    machine.run();
+    CHECK(machine.in_halt_condition());
+    CHECK(machine.get_registers().getA() == 4);
+
+    // Stops in front of the instruction that stored 4
+    CHECK(machine.reverse_to_last_change(0x102));
+    CHECK(machine.get_instruction_count() == 5);
+    CHECK(machine.get_registers().getPc() == 15);
+
+    machine.run();
+    machine.set_execution_breakpoint(6);
+    CHECK(machine.reverse_continue());
+    CHECK(machine.get_instruction_count() == 2);
+    CHECK(machine.get_registers().getPc() == 6);
+
+    machine.clear_execution_breakpoints();
+    CHECK(!machine.reverse_continue());
+    CHECK(machine.get_instruction_count() == 0);
+    CHECK(!machine.reverse_step());
+}
+
+// Re-execution past the journal goes through a checkpoint
+static void test_checkpoint_travel() {
+    Machine machine {0, make_counter()};
+    machine.set_change_recording(false);
+    machine.set_checkpoint_interval(2);
+    machine.run();
+    CHECK(machine.get_checkpoint_count() == 4);
+
+    CHECK(machine.reverse_step(4));
+    CHECK(machine.get_instruction_count() == 3);
+    CHECK(machine.get_registers().getA() == 3);
+    CHECK(machine.get_memory()->get_word(0x100) == 0);
+}
+
+static void test_device_log_off() {
+    Machine machine {0, make_poll_loop()};
+    machine.set_device(5, std::make_unique<MemoryDevice>());
+    machine.set_device_logging(false);
+    machine.run_until(100000, 0);
+    CHECK(!machine.is_device_logging());
+    CHECK(machine.get_device_event_count() == 0);
+}
+
+// A TD every other instruction, the log is trimmed along with the oldest checkpoints
+static void test_device_log_bound() {
+    Machine machine {0, make_poll_loop(), ExecutionEngine::Threaded};
+    machine.set_device(5, std::make_unique<MemoryDevice>());
+    machine.set_change_recording(false);
+
+    static constexpr uint64_t instructions = 8 << 20;
+    machine.run_until(instructions, 0);
+    CHECK(machine.get_instruction_count() == instructions);
+    CHECK(machine.get_device_event_count() < instructions / 4);
+    CHECK(machine.get_device_event_count() <= 2 << 20);
+
+    // The oldest checkpoint is as far back as time travel goes
+    CHECK(!machine.reverse_continue());
+    CHECK(machine.get_instruction_count() > 0);
+    CHECK(machine.get_registers().getPc() % 3 == 0);
+
+    machine.run_until(instructions, 0);
+    CHECK(machine.get_instruction_count() == instructions);
+}
+
+int main() {
+    for (auto engine : {ExecutionEngine::Interpreter, ExecutionEngine::Threaded, ExecutionEngine::BasicBlock}) {
+        test_reverse_execution(engine);
+    }
+    test_checkpoint_travel();
+    test_device_log_off();
+    test_device_log_bound();
+    return test_result();
+}
@@ -0,0 +1,91 @@
+//
+// Created by Lenart on 18/10/2026.
+//
+
+#include <filesystem>
+#include <sstream>
+#include "TestUtil.h"
+#include "../sim/Machine.h"
+#include "../sim/Trace.h"
+
+// LDA #5, SUB #7, STA 0x100, STCH 0x200, J over an ADD to the halting J at 18
+static std::shared_ptr<Memory> make_stores() {
+    return make_program({
+        0x01, 0x00, 0x05,
+        0x1D, 0x00, 0x07,
+        0x0F, 0x01, 0x00,
+        0x57, 0x02, 0x00,
+        0x3F, 0x20, 0x03,
+        0x19, 0x00, 0x01,
+        0x3F, 0x2F, 0xFD
+    });
+}
+
+static void test_round_trip(ExecutionEngine engine) {
+    auto file_name = (std::filesystem::temp_directory_path() / "ass2_trace_test.trace").string();
+
+    Machine machine {0, make_stores(), engine};
+    auto start_registers = machine.get_registers();
+    machine.set_trace(std::make_unique<TraceRecorder>(file_name, start_registers));
+    machine.run();
+    CHECK(machine.in_halt_condition());
+    machine.set_trace(nullptr);
+
+    std::ifstream stream {file_name, std::ios::binary};
+    TraceReader reader {stream};
+    CHECK(reader.is_valid());
+
+    std::vector<TraceRecord> records {};
+    for (TraceRecord record; reader.next(record);) records.push_back(record);
+    std::filesystem::remove(file_name);
+
+    CHECK(records.size() == machine.get_instruction_count());
+    if (records.size() != 6) return;
+
+    static constexpr std::array<Address_t, 6> pcs {0, 3, 6, 9, 12, 18};
+    for (size_t i = 0; i < records.size(); i++) {
+        CHECK(records[i].index == i);
+        CHECK(records[i].pc == pcs[i]);
+        CHECK(records[i].length == 3);
+    }
+    CHECK(records[1].bytes[0] == 0x1D && records[1].bytes[2] == 0x07);
+
+    // A goes negative, the change is encoded as a signed delta
+    CHECK(records[1].register_changes.size() == 1);
+    if (!records[1].register_changes.empty()) {
+        auto& change = records[1].register_changes[0];
+        CHECK(change.register_id == Register::A);
+        CHECK(change.previous_value == 5);
+        CHECK(change.new_value == -2);
+    }
+
+    CHECK(records[2].memory_changes.size() == 1);
+    CHECK(records[3].memory_changes.size() == 1);
+    CHECK(records[0].memory_changes.empty());
+
+    // Where the last jump went is only known from a following record
+    for (auto reg : trace_format::registers) {
+        if (reg == Register::PC) continue;
+        CHECK(reader.get_registers().get(reg) == machine.get_registers().get(reg));
+    }
+    CHECK(reader.get_memory()->get_word(0x100) == machine.get_memory()->get_word(0x100));
+    CHECK(reader.get_memory()->get_byte(0x200) == 0xfe);
+    CHECK(reader.get_memory()->get_byte(12) == 0x3F);
+}
+
+static void test_invalid_stream() {
+    std::stringstream stream {"SICTRACX and more"};
+    TraceReader reader {stream};
+    CHECK(!reader.is_valid());
+
+    TraceRecord record {};
+    CHECK(!reader.next(record));
+}
+
+int main() {
+    for (auto engine : {ExecutionEngine::Interpreter, ExecutionEngine::Threaded, ExecutionEngine::BasicBlock}) {
+        test_round_trip(engine);
+    }
+    test_invalid_stream();
+    return test_result();
+}